@@ -0,0 +1,240 @@
+import argparse
+import datetime
+import struct
+import sys
+import time
+
+# Configures and audits the coop over Serial, using the binary protocol described in Main_I2C/Protocol.h.
+# Needs pyserial. Examples:
+#   python GallineroCli.py /dev/ttyUSB0 status
+#   python GallineroCli.py /dev/ttyUSB0 set --timezone 1 --open-delay 15 --close-delay -10
+#   python GallineroCli.py /dev/ttyUSB0 time              (sets the board to this computer's clock)
+#   python GallineroCli.py /dev/ttyUSB0 open --door 2
+#   python GallineroCli.py /dev/ttyUSB0 stats --door 1
+#   python GallineroCli.py /dev/ttyUSB0 metrics
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+CMD_GET_STATUS = 0x01
+CMD_GET_SETTINGS = 0x02
+CMD_SET_SETTINGS = 0x03
+CMD_SET_TIME = 0x04
+CMD_DOOR = 0x05
+CMD_GET_STATS = 0x06
+CMD_GET_METRICS = 0x07
+REPLY = 0x80
+
+DOOR_ACTIONS = {"open": 1, "close": 2, "calibrate": 3}
+ALL_DOORS = 0xFF
+
+STATUS_NAMES = ["ok", "bad CRC", "unknown command", "bad length", "bad argument"]
+STEP_MODES = ["wave drive", "full step", "half step"]
+RESET_CAUSES = ["power-on", "external", "brown-out", "watchdog", "unknown"]
+
+# Opening the port resets the board, which then shows the welcome screen and may finish an interrupted move
+BOOT_TIME = 4
+
+
+def crc8(data):
+	crc = 0
+	for b in data:
+		crc ^= b
+		for i in range(8):
+			crc = (crc >> 1) ^ 0x8C if crc & 0x01 else crc >> 1
+	return crc
+
+
+def slip_encode(payload):
+	out = bytearray([SLIP_END])
+	for b in payload:
+		if b == SLIP_END:
+			out += bytes([SLIP_ESC, SLIP_ESC_END])
+		elif b == SLIP_ESC:
+			out += bytes([SLIP_ESC, SLIP_ESC_ESC])
+		else:
+			out.append(b)
+	out.append(SLIP_END)
+	return bytes(out)
+
+
+def slip_decode(frame):
+	out = bytearray()
+	escaped = False
+	for b in frame:
+		if escaped:
+			out.append(SLIP_END if b == SLIP_ESC_END else SLIP_ESC if b == SLIP_ESC_ESC else b)
+			escaped = False
+		elif b == SLIP_ESC:
+			escaped = True
+		else:
+			out.append(b)
+	return bytes(out)
+
+
+class Coop:
+	def __init__(self, port):
+		import serial
+		self.ser = serial.Serial(port, 9600, timeout=1)
+		time.sleep(BOOT_TIME)
+		self.ser.reset_input_buffer()
+
+	def request(self, command, data=b"", timeout=120):
+		payload = bytes([command]) + data
+		self.ser.write(slip_encode(payload + bytes([crc8(payload)])))
+
+		# The board also prints text (free memory, messages), so anything between two ENDs that is not
+		# a valid reply to this command is skipped
+		frame = bytearray()
+		deadline = time.time() + timeout
+		while time.time() < deadline:
+			b = self.ser.read(1)
+			if not b:
+				continue
+			if b[0] != SLIP_END:
+				frame.append(b[0])
+				continue
+			reply = slip_decode(frame)
+			frame = bytearray()
+			if len(reply) >= 3 and reply[0] == command | REPLY and crc8(reply[:-1]) == reply[-1]:
+				if reply[1] != 0:
+					status = STATUS_NAMES[reply[1]] if reply[1] < len(STATUS_NAMES) else str(reply[1])
+					raise RuntimeError("Board replied: " + status)
+				return reply[2:-1]
+		raise RuntimeError("No reply from the board")
+
+
+def show_status(coop):
+	data = coop.request(CMD_GET_STATUS)
+	hour, minute, day, month, year, temp, headroom, count = struct.unpack_from("<BBBBHhHB", data)
+	print("Time: {0:04d}/{1:02d}/{2:02d} {3:02d}:{4:02d}".format(year, month, day, hour, minute))
+	print("Temperature: {0:.2f} C".format(temp / 100.0))
+	print("Stack headroom: {0} bytes".format(headroom))
+	for i in range(count):
+		flags, position, steps = struct.unpack_from("<BhH", data, 11 + 5*i)
+		state = "open" if flags & 0x01 else "closed"
+		drift = ", needs checking" if flags & 0x02 else ""
+		print("Door {0}: {1}, position {2} of {3} steps{4}".format(i + 1, state, position, steps, drift))
+
+
+def get_settings(coop):
+	data = coop.request(CMD_GET_SETTINGS)
+	timezone, open_delay, close_delay, open_mode, close_mode = struct.unpack_from("<bbbBB", data)
+	steps = list(struct.unpack_from("<{0}H".format((len(data) - 5) // 2), data, 5))
+	return [timezone, open_delay, close_delay, open_mode, close_mode, steps]
+
+
+def show_settings(coop):
+	timezone, open_delay, close_delay, open_mode, close_mode, steps = get_settings(coop)
+	print("Timezone: UTC{0:+d}".format(timezone))
+	print("Open delay: {0} min, close delay: {1} min".format(open_delay, close_delay))
+	print("Stepping: {0} to open, {1} to close".format(STEP_MODES[open_mode], STEP_MODES[close_mode]))
+	for i, n in enumerate(steps):
+		print("Door {0}: {1} steps to close".format(i + 1, n))
+
+
+def set_settings(coop, args):
+	settings = get_settings(coop)
+	for index, value in enumerate([args.timezone, args.open_delay, args.close_delay, args.open_mode, args.close_mode]):
+		if value is not None:
+			settings[index] = value
+	if args.steps is not None:
+		settings[5][args.door - 1] = args.steps
+
+	timezone, open_delay, close_delay, open_mode, close_mode, steps = settings
+	data = struct.pack("<bbbBB", timezone, open_delay, close_delay, open_mode, close_mode)
+	data += struct.pack("<{0}H".format(len(steps)), *steps)
+	coop.request(CMD_SET_SETTINGS, data)
+	show_settings(coop)
+
+
+def set_time(coop, args):
+	if args.datetime:
+		now = datetime.datetime.strptime(args.datetime, "%Y-%m-%d %H:%M:%S")
+	else:
+		now = datetime.datetime.now()
+	coop.request(CMD_SET_TIME, struct.pack("<HBBBBB", now.year, now.month, now.day, now.hour, now.minute, now.second))
+	print("Time set to {0}".format(now.strftime("%Y-%m-%d %H:%M:%S")))
+
+
+def show_stats(coop, args):
+	data = coop.request(CMD_GET_STATS, bytes([args.door - 1]))
+	fields = "<HHHHIHI"
+	size = struct.calcsize(fields)
+	for name, offset in (("Open", 0), ("Close", size)):
+		count, timeouts, min_steps, max_steps, total, last_steps, last_duration = struct.unpack_from(fields, data, offset)
+		mean = total // count if count else 0
+		print("{0}: {1} moves, {2} timeouts, steps min {3} / mean {4} / max {5}, last {6} steps in {7} ms".format(
+			name, count, timeouts, min_steps, mean, max_steps, last_steps, last_duration))
+	if data[2*size]:
+		print("Door drift flagged: check the door or recalibrate it")
+
+
+def show_metrics(coop):
+	data = coop.request(CMD_GET_METRICS)
+	opens, closes, timeouts, motor_ms, i2c_errors = struct.unpack_from("<HHHIH", data)
+	resets = struct.unpack_from("<5H", data, 12)
+	last_reset, uptime = struct.unpack_from("<BI", data, 22)
+	print("Moves: {0} opens, {1} closes, {2} timeouts, motor on {3} s".format(opens, closes, timeouts, motor_ms // 1000))
+	print("I2C errors: {0}".format(i2c_errors))
+	print("Resets: " + ", ".join("{0} {1}".format(count, name) for name, count in zip(RESET_CAUSES, resets)))
+	print("MCUSR at the last boot: 0x{0:02X}".format(last_reset))
+	print("Uptime: {0:.1f} days".format(uptime / 86400.0))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Configure and audit the coop over Serial")
+	parser.add_argument("port", help="serial port, e.g. /dev/ttyUSB0 or COM3")
+	commands = parser.add_subparsers(dest="command")
+	commands.required = True
+
+	commands.add_parser("status")
+	commands.add_parser("settings")
+
+	set_parser = commands.add_parser("set", help="change settings (the rest keep their value)")
+	set_parser.add_argument("--timezone", type=int)
+	set_parser.add_argument("--open-delay", type=int)
+	set_parser.add_argument("--close-delay", type=int)
+	set_parser.add_argument("--open-mode", type=int, choices=range(3), help="0 wave drive, 1 full step, 2 half step")
+	set_parser.add_argument("--close-mode", type=int, choices=range(3))
+	set_parser.add_argument("--steps", type=int, help="steps to close --door")
+	set_parser.add_argument("--door", type=int, default=1)
+
+	time_parser = commands.add_parser("time", help="set the RTC")
+	time_parser.add_argument("datetime", nargs="?", help='"YYYY-MM-DD HH:MM:SS" (default: now)')
+
+	for action in DOOR_ACTIONS:
+		door_parser = commands.add_parser(action)
+		door_parser.add_argument("--door", type=int, help="door number (default: all doors)")
+
+	stats_parser = commands.add_parser("stats")
+	stats_parser.add_argument("--door", type=int, default=1)
+
+	commands.add_parser("metrics")
+
+	args = parser.parse_args()
+	coop = Coop(args.port)
+
+	if args.command == "status":
+		show_status(coop)
+	elif args.command == "settings":
+		show_settings(coop)
+	elif args.command == "set":
+		set_settings(coop, args)
+	elif args.command == "time":
+		set_time(coop, args)
+	elif args.command in DOOR_ACTIONS:
+		if args.command == "calibrate" and args.door is None:
+			sys.exit("Calibrate one door at a time (--door), after closing it by hand")
+		door = ALL_DOORS if args.door is None else args.door - 1
+		coop.request(CMD_DOOR, bytes([DOOR_ACTIONS[args.command], door]))
+		print("Started. The board answers before the door stops: 'status' shows its position.")
+	elif args.command == "stats":
+		show_stats(coop, args)
+	elif args.command == "metrics":
+		show_metrics(coop)
+
+
+main()
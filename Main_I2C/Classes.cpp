@@ -1,9 +1,11 @@
 #include "Classes.h"
 #include "Strings.h"
-#include <Stepper.h>
+#include "StepperDriver.h"
 #include <LiquidCrystal_I2C.h>
-#include <DS3231.h>
-#include <EEPROM.h>
+#include "Rtc.h"
+#include "Settings.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include "EEPROM_ADDRESSES.h"
 #include "SunSchedule.h"
 
@@ -12,134 +14,507 @@
 /****************************************************************/
 bool Button::isPressed() const
 {
-	return digitalRead(m_pin);
+	return m_pin.read();
 }
 
 
 /****************************************************************/
 /*						DOOR									*/
 /****************************************************************/
-Door::Door(byte switch_pin, int steps, Stepper* m, LiquidCrystal_I2C* d) : m_switch_pin(switch_pin), m_open(false), m_stepsToClose(steps), m_motor(m), m_display(d), m_blocked(false)
+byte Door::s_relayUsers = 0;
+
+static_assert(sizeof(DoorPosition) <= JOURNAL_MAX_DATA(DOOR_POSITION_SLOT_SIZE), "DoorPosition does not fit a position journal slot");
+static_assert(sizeof(uint32_t) <= JOURNAL_MAX_DATA(TRANSITION_SLOT_SIZE), "A transition number does not fit a transition journal slot");
+
+// Step intervals, in microseconds, from a standing start: 100 steps/s up to 400. The motor stays at MOTOR_SPEED
+// where that is slower, and the end of a close slows down the same way.
+const uint16_t doorRamp[DOOR_RAMP_LENGTH] PROGMEM = {10000, 7500, 6000, 5000, 4300, 3750, 3300, 3000, 2750, 2500};
+
+Door::Door(byte index, byte switch_pin, int steps, StepperDriver* m, LiquidCrystal_I2C* d, Settings* s) : m_index(index), m_switch(switch_pin), m_open(false),
+m_stepsToClose(steps), m_position(0), m_interruptedMove(DOOR_IDLE), m_motor(m), m_openMode(FULL_STEP), m_closeMode(FULL_STEP), m_openEnergy(0), m_closeEnergy(0),
+m_display(d), m_settings(s), m_stats(DOOR_STATS_JOURNAL_ADDR + index * DOOR_EEPROM_STRIDE),
+m_positionJournal(DOOR_POSITION_JOURNAL_ADDR + index * DOOR_EEPROM_STRIDE, DOOR_POSITION_JOURNAL_SIZE, DOOR_POSITION_SLOT_SIZE), m_blocked(false), m_relayOn(false),
+m_move(DOOR_IDLE), m_holding(false), m_homingCoarse(0), m_homingFine(0), m_homingFailed(false)
 {
-	pinMode(switch_pin, INPUT);
-	pinMode(RELAY_PIN, OUTPUT);
-	digitalWrite(RELAY_PIN, LOW);
+	m_switch.input();
+	m_motor->setRamp(doorRamp, DOOR_RAMP_LENGTH);
+	FastPin<RELAY_PIN>::output();
+	FastPin<RELAY_PIN>::low();
+	m_lastSaved.move = 0xFF; // never matches, so the first checkpoint is always written
 }
 
+// Blocks until the door has stopped
 void Door::open(bool override_open)
 {
-	if (m_blocked)
+	startOpen(override_open);
+	while (!m_run())
+	{}
+}
+
+// Closes by running only the distance left to the closed position, so it does not over-drive the door
+// after a manual adjustment or an interrupted move.
+void Door::close()
+{
+	startClose();
+	while (!m_run())
+	{}
+}
+
+void Door::startOpen(bool override_open)
+{
+	if (moving() || !m_beginOpen(override_open))
 		return;
 
-	if (m_open && !override_open)
+	m_move = DOOR_OPENING;
+	m_holding = false;
+}
+
+void Door::startClose()
+{
+	if (moving() || !m_beginClose())
 		return;
 
-	m_openRelay();
+	m_move = DOOR_CLOSING;
+	m_holding = false;
+}
+
+// The user has just closed the door by hand. Blocked doors can be calibrated.
+void Door::startCalibrate()
+{
+	if (moving())
+		return;
+
+	m_beginCalibrate();
+	m_move = DOOR_CALIBRATING;
+	m_holding = false;
+}
 
-	int steps = 0;
-	int switch_pos = digitalRead(m_switch_pin);
+// The motor steps in the background (see StepperDriver::run()); this keeps count. Once the last step is taken, the
+// coils hold the door for MOTOR_HOLD_TIME so it settles, then the move is ended.
+bool Door::m_run()
+{
+	if (m_move == DOOR_IDLE)
+		return true;
 
-	printMessage(m_display, DOOR_OPENING_MSG);
-	while (switch_pos == 0)
+	if (!m_holding)
 	{
-		switch_pos = digitalRead(m_switch_pin);
-		m_motor->step(STEPPER_DIRECTION);
-		steps++;
-		if (steps > MAX_STEPS)
-			break;
+		bool running = m_motor->running(); // before the count, so that the count is final once this is false
+		unsigned int taken = m_motor->stepsTaken();
+		if (m_move == DOOR_OPENING)
+			m_moveSteps = taken;
+		else if (m_move == DOOR_CLOSING)
+			m_followClose(taken);
+		else
+			m_position = (m_homing == HOMING_BACKOFF) ? m_startPosition - taken : m_startPosition + taken;
+
+		if (running)
+			return false;
+		if (m_move == DOOR_CALIBRATING && m_nextHoming())
+			return false;
+
+		m_moveTimeout = (m_move == DOOR_OPENING && taken >= MAX_STEPS);
+		m_holding = true;
+		m_holdStart = micros();
+		return false;
 	}
-	m_open = true;
 
-	EEPROM.put(DOOR_STATE_EEPROM_ADDR, m_open);
+	if (micros() - m_holdStart < MOTOR_HOLD_TIME * 1000UL)
+		return false;
+
+	byte move = m_move;
+	m_move = DOOR_IDLE;
+	m_holding = false;
+	if (move == DOOR_OPENING)
+		m_endOpen();
+	else if (move == DOOR_CLOSING)
+		m_endClose();
+	else
+		m_endCalibrate();
+	return true;
+}
 
-	m_closeRelay();
+// Returns false if the door does not need to move
+bool Door::m_beginOpen(bool override_open)
+{
+	if (m_blocked)
+		return false;
+
+	if (m_open && !override_open)
+		return false;
+
+	m_openRelay();
+	m_motor->setMode(m_openMode);
+	m_motor->resetEnergy();
+	m_traceStart(TRACE_DOOR_OPEN);
+	m_moveStart = millis();
+	m_wasOpen = m_open;
+	m_startPosition = m_position;
+
+	// Saved once, at the start: if this is interrupted, recover() opens again up to the limit switch, which gives
+	// the position back, so nothing needs saving on the way up
+	m_checkpoint(DOOR_OPENING);
+
+	m_moveSteps = 0;
+	m_moveTimeout = false;
+	m_motor->run(STEPPER_DIRECTION, MAX_STEPS, &m_switch); // up to the limit switch
+
+	if (FEATURE_DISPLAY)
+		printMessage(m_display, DOOR_OPENING_MSG);
+	return true;
 }
 
-void Door::close()
+void Door::m_endOpen()
+{
+	m_open = true;
+	m_position = m_stepsToClose; // the limit switch marks the open position
+	m_checkpoint(DOOR_IDLE);
+
+	m_endMove();
+	m_openEnergy = m_motor->energy();
+	metrics.recordOpen(millis() - m_moveStart, m_moveTimeout);
+	// A forced re-open starts from an unknown position, so its step count says nothing about the door's travel
+	if (!m_wasOpen && m_startPosition >= 0 && m_startPosition < (int)m_stepsToClose)
+		m_stats.recordOpen(m_moveSteps, millis() - m_moveStart, m_moveTimeout, m_stepsToClose - m_startPosition);
+	trace.record(TRACE_DOOR_STOP, m_moveSteps);
+	trace.flush();
+}
+
+bool Door::m_beginClose()
 {
 	if (m_blocked)
-		return;
+		return false;
 
 	if (m_stepsToClose < 1 || !m_open)
-		return;
+		return false;
 
 	m_openRelay();
+	m_motor->setMode(m_closeMode);
+	m_motor->resetEnergy();
+	m_traceStart(TRACE_DOOR_CLOSE);
+	m_moveStart = millis();
+	m_moveSteps = 0;
+
+	m_chunk = m_stepsToClose / DOOR_CLOSE_CHECKPOINTS;
+	if (m_chunk < DOOR_MIN_CHECKPOINT_STEPS)
+		m_chunk = DOOR_MIN_CHECKPOINT_STEPS;
+	m_startPosition = (m_position > 0) ? m_position : 0;
+	m_chunkEnd = m_startPosition;
+	m_motor->run(-STEPPER_DIRECTION, 0);
+	m_nextChunk();
+
+	if (FEATURE_DISPLAY)
+		printMessage(m_display, DOOR_CLOSING_MSG);
+	return true;
+}
 
-	printMessage(m_display, DOOR_CLOSING_MSG);
-	m_motor->step(-m_stepsToClose * STEPPER_DIRECTION);
-	m_open = false;
+// Closes in chunks. Before the motor is given each chunk, the position the door will have at the end of it is saved,
+// so after a reset the saved position is never further open than the real one: the recovery move may stop a few
+// steps short, but it never drives past the closed position. The next chunk is handed over DOOR_CHECKPOINT_LEAD
+// steps before the motor runs out of the current one, so it does not have to stop and wait for the EEPROM.
+void Door::m_followClose(unsigned int taken)
+{
+	m_moveSteps = taken;
+	m_position = m_startPosition - taken;
+	if (m_chunkEnd > 0 && m_position <= m_chunkEnd + DOOR_CHECKPOINT_LEAD)
+		m_nextChunk();
+}
 
-	EEPROM.put(DOOR_STATE_EEPROM_ADDR, m_open);
+void Door::m_nextChunk()
+{
+	int end = (m_chunkEnd > (int)m_chunk) ? m_chunkEnd - m_chunk : 0;
+	m_savePosition(end, DOOR_CLOSING);
+	m_motor->extend(m_chunkEnd - end);
+	m_chunkEnd = end;
+}
 
-	m_closeRelay();
+void Door::m_endClose()
+{
+	m_open = false;
+	m_checkpoint(DOOR_IDLE);
+
+	m_endMove();
+	m_closeEnergy = m_motor->energy();
+	metrics.recordClose(millis() - m_moveStart);
+	m_stats.recordClose(m_moveSteps, millis() - m_moveStart, false);
+	trace.record(TRACE_DOOR_STOP, m_moveSteps);
+	trace.flush();
+}
+
+// The door number goes in the high byte, so the trace tells concurrent moves apart
+void Door::m_traceStart(byte move)
+{
+	trace.record(TRACE_DOOR_START, move | (m_index << 8));
+	trace.recordTime();
 }
 
-void Door::calibrate()
+void Door::m_beginCalibrate()
 {
 	m_openRelay();
+	m_motor->setMode(m_openMode);
+	m_traceStart(TRACE_DOOR_CALIBRATE);
+	m_moveStart = millis();
+
+	if (FEATURE_DISPLAY)
+	{
+		printMessage(m_display, DOOR_CALIBRATING_MSG);
+		m_display->setCursor(0, 1);
+		m_display->print(F("door..."));
+	}
 
-	printMessage(m_display, DOOR_CALIBRATING_MSG);
-	m_display->setCursor(0, 1);
-	m_display->print(F("door..."));
+	m_position = 0;
+	m_checkpoint(DOOR_OPENING);
 
-	m_stepsToClose = 0;
-	int switch_pos = digitalRead(m_switch_pin);
-	while (switch_pos == 0)
+	m_homing = HOMING_FAST;
+	m_startPosition = 0;
+	m_homingCoarse = 0;
+	m_homingFine = 0;
+	m_homingFailed = false;
+	m_motor->run(STEPPER_DIRECTION, MAX_STEPS + 1, &m_switch, DOOR_HOMING_FAST_STEP); // counting the steps to the limit switch
+}
+
+// Called when a pass of the calibration is over. The fast pass overshoots the switch by however far the door coasts
+// at speed; the slow one stops within a step of where it trips, so that is where the open position is counted to.
+// Returns false once the calibration is over, with m_homingFailed set if m_homing did not end on the switch.
+bool Door::m_nextHoming()
+{
+	if (m_homing == HOMING_FAST)
 	{
-		switch_pos = digitalRead(m_switch_pin);
-		m_motor->step(STEPPER_DIRECTION);
-		m_stepsToClose++;
-		if (m_stepsToClose > MAX_STEPS)
-			break;
+		m_homingCoarse = m_position;
+		if (!m_switch.read())
+		{
+			m_homingFailed = true; // ran out of steps without finding the switch
+			return false;
+		}
+		m_homing = HOMING_BACKOFF;
+		m_startPosition = m_position;
+		m_motor->run(-STEPPER_DIRECTION, DOOR_HOMING_BACKOFF);
+		return true;
+	}
+
+	if (m_homing == HOMING_BACKOFF)
+	{
+		if (m_switch.read())
+		{
+			m_homingFailed = true; // still pressed, so the slow pass would stop before its first step
+			return false;
+		}
+		m_homing = HOMING_SLOW;
+		m_startPosition = m_position;
+		m_motor->run(STEPPER_DIRECTION, 2*DOOR_HOMING_BACKOFF, &m_switch, DOOR_HOMING_SLOW_STEP);
+		return true;
 	}
 
-	printMessage(m_display, DOOR_CALIBRATED_MSG);
-	m_display->setCursor(0, 1);
-	printMessage(m_display, COMPLETE_MSG, false);
-	delay(2000);
-	printMessage(m_display, DOOR_STEPS_MSG);
-	m_display->setCursor(0, 1);
-	m_display->print(m_stepsToClose);
+	m_homingFine = m_position - m_startPosition;
+	m_homingFailed = !m_switch.read(); // 2*DOOR_HOMING_BACKOFF steps without finding it again
+	return false;
+}
+
+// A failed calibration keeps the old one. The door is left open where it stopped: closing from there runs back
+// down the steps that were counted on the way up.
+void Door::m_endCalibrate()
+{
+	if (FEATURE_DISPLAY)
+	{
+		printMessage(m_display, DOOR_CALIBRATED_MSG);
+		m_display->setCursor(0, 1);
+		printMessage(m_display, m_homingFailed ? FAILED_MSG : COMPLETE_MSG, false);
+	}
 	m_open = true;
+	if (!m_homingFailed)
+	{
+		m_stepsToClose = m_position;
+		m_settings->setStepsToClose(m_index, m_stepsToClose);
+		m_settings->commit();
+	}
+	m_checkpoint(DOOR_IDLE);
 
-	EEPROM.put(STEPS_TO_CLOSE_EEPROM_ADDR, m_stepsToClose);
-	EEPROM.put(DOOR_STATE_EEPROM_ADDR, m_open);
+	m_endMove();
+	metrics.recordMotor(millis() - m_moveStart);
+	trace.record(TRACE_HOMING_COARSE, m_homingCoarse);
+	if (m_homingFailed)
+	{
+		trace.record(TRACE_HOMING_FAILED, m_homing);
+		trace.record(TRACE_DOOR_STOP, m_position);
+		trace.flush();
+		return;
+	}
+	m_stats.reset(); // old statistics were measured against the old calibration
+	trace.record(TRACE_HOMING_FINE, m_homingFine);
+	trace.record(TRACE_DOOR_STOP, m_stepsToClose);
+	trace.flush();
+}
 
-	m_closeRelay();
+// Manual moves are not saved step by step, and the coils stay energised between steps. Call endManualMove() once
+// the button is released.
+void Door::startManualMove(bool open)
+{
+	m_openRelay();
+	m_motor->setMode(open ? m_openMode : m_closeMode);
 }
 
 void Door::openSteps(int steps)
 {
-	m_openRelay();
 	m_motor->step(steps * STEPPER_DIRECTION);
-	m_closeRelay();
+	m_position += steps;
 }
 
 void Door::closeSteps(int steps)
 {
-	m_openRelay();
 	m_motor->step(steps * (-STEPPER_DIRECTION));
+	m_position -= steps;
+}
+
+void Door::endManualMove()
+{
 	m_closeRelay();
+	m_checkpoint(DOOR_IDLE);
+}
+
+// Returns false if no position was ever saved (first boot after an upgrade)
+bool Door::restore()
+{
+	DoorPosition saved;
+	if (m_positionJournal.load(&saved, sizeof(saved)) != sizeof(saved))
+		return false;
+
+	m_position = saved.position;
+	m_open = saved.open;
+	m_interruptedMove = saved.move;
+	m_lastSaved = saved;
+	return true;
+}
+
+// Finishes a move that was interrupted by a reset. An opening runs to the limit switch again.
+// A closing runs the remaining distance from the end of the last chunk that was saved (see m_followClose()), which
+// is never further open than the door really was.
+void Door::recover()
+{
+	byte move = m_interruptedMove;
+	m_interruptedMove = DOOR_IDLE;
+
+	if (move == DOOR_OPENING)
+	{
+		m_open = true; // the position was not tracked on the way up, so keep this out of the statistics
+		open(true);
+	}
+	else if (move == DOOR_CLOSING)
+	{
+		m_open = true;
+		close();
+	}
+}
+
+void Door::m_checkpoint(byte move)
+{
+	m_savePosition(m_position, move);
+}
+
+// Saves the position only if it changed, into a small journal of its own
+void Door::m_savePosition(int position, byte move)
+{
+	DoorPosition current;
+	current.position = position;
+	current.open = m_open;
+	current.move = move;
+
+	if (current.position == m_lastSaved.position && current.open == m_lastSaved.open && current.move == m_lastSaved.move)
+		return;
+
+	m_positionJournal.save(&current, sizeof(current));
+	m_lastSaved = current;
 }
 
 void Door::m_openRelay()
 {
-	digitalWrite(RELAY_PIN, HIGH);
+	if (m_relayOn)
+		return;
+
+	m_relayOn = true;
+	if (s_relayUsers++ == 0)
+		FastPin<RELAY_PIN>::high();
 }
 
 void Door::m_closeRelay()
 {
-	digitalWrite(RELAY_PIN, LOW);
+	m_motor->release();
+	if (!m_relayOn)
+		return;
+
+	m_relayOn = false;
+	if (--s_relayUsers == 0)
+		FastPin<RELAY_PIN>::low();
+}
+
+// Cuts the coil current, once the door has settled (see m_run())
+void Door::m_endMove()
+{
+	m_closeRelay();
+}
+
+
+/****************************************************************/
+/*						DOOR GROUP								*/
+/****************************************************************/
+bool DoorGroup::anyOpen() const
+{
+	for (byte i = 0; i < m_count; i++)
+	{
+		if (m_doors[i].isOpen())
+			return true;
+	}
+	return false;
+}
+
+bool DoorGroup::moving() const
+{
+	for (byte i = 0; i < m_count; i++)
+	{
+		if (m_doors[i].moving())
+			return true;
+	}
+	return false;
+}
+
+void DoorGroup::startOpen(bool override_open)
+{
+	for (byte i = 0; i < m_count; i++)
+		m_doors[i].startOpen(override_open);
+}
+
+void DoorGroup::startClose()
+{
+	for (byte i = 0; i < m_count; i++)
+		m_doors[i].startClose();
+}
+
+// A step takes several milliseconds, which is too long to leave loop() waiting between two of them, and a slice is
+// short enough that the buttons and the clock are still looked at several times a second.
+bool DoorGroup::run()
+{
+	unsigned long start = micros();
+	bool stopped;
+	do
+	{
+		stopped = true;
+		for (byte i = 0; i < m_count; i++)
+		{
+			if (!m_doors[i].m_run())
+				stopped = false;
+		}
+	} while (!stopped && micros() - start < DOOR_RUN_SLICE * 1000UL);
+	return stopped;
 }
 
 
 /****************************************************************/
 /*						CLOCK									*/
 /****************************************************************/
-Clock::Clock(signed_byte tzone) : m_timezone(tzone)
+Clock::Clock(signed_byte tzone) : m_timezone(tzone), m_openDelay(0), m_closeDelay(0),
+m_transitionJournal(TRANSITION_JOURNAL_ADDR, TRANSITION_JOURNAL_SIZE, TRANSITION_SLOT_SIZE)
 {
-	m_rtc = new DS3231(SDA, SCL);
-	m_rtc->begin();
+	m_rtc = new Rtc();
+	m_schedule.setRule(0, RULE_SUNRISE, 0, true);
+	m_schedule.setRule(1, RULE_SUNSET, 0, false);
 	m_lastReading_riseListener = isDay();
 	m_lastReading_setListener = m_lastReading_riseListener;
 }
@@ -147,6 +522,7 @@ Clock::Clock(signed_byte tzone) : m_timezone(tzone)
 void Clock::setTimezone(signed_byte tzone)
 {
 	m_timezone = tzone;
+	m_schedule.invalidate();
 }
 
 void Clock::setTime(byte hour, byte minute)
@@ -160,13 +536,20 @@ void Clock::setDate(int year, byte month, byte day)
 	m_rtc->setDate(day, month, year);
 }
 
+bool Clock::setDateTime(int year, byte month, byte day, byte hour, byte minute, byte second)
+{
+	return m_rtc->setDate(day, month, year) && m_rtc->setTime(hour, minute, second);
+}
+
 void Clock::setOpenDelay(signed_byte delay)
 {
 	m_openDelay = delay;
+	m_schedule.setRule(0, RULE_SUNRISE, delay, true);
 }
 void Clock::setCloseDelay(signed_byte delay)
 {
 	m_closeDelay = delay;
+	m_schedule.setRule(1, RULE_SUNSET, delay, false);
 }
 
 byte Clock::getDay() const
@@ -201,59 +584,51 @@ byte Clock::getMin() const
 
 String Clock::getTimeStr() const
 {
-	return m_rtc->getTimeStr(FORMAT_SHORT);
+	return m_rtc->getTimeStr();
 }
 
 String Clock::getDateStr() const
 {
-	return m_rtc->getDateStr(FORMAT_LONG, FORMAT_BIGENDIAN, '/');
+	return m_rtc->getDateStr();
 }
 
-String Clock::getOpenTimeStr() const
+String Clock::getOpenTimeStr()
 {
-	int daynum = m_getDayNum();
-	byte hour = getSunriseHour(daynum);
-	byte min = getSunriseMinute(daynum);
-	m_addMinutes(hour, min, m_timezone*60 + m_openDelay);
+	Time currentTime = m_rtc->getTime();
+	m_compile(currentTime);
+	int minute = m_schedule.next(currentTime.hour*60 + currentTime.min, true);
+	if (minute < 0)
+		return "--:--";
 
-	char str[5];
-	sprintf(str, "%02d:%02d", hour, min);
+	char str[6];
+	m_formatMinute(str, minute);
 	return str;
 }
 
-String Clock::getCloseTimeStr() const
+String Clock::getCloseTimeStr()
 {
-	int daynum = m_getDayNum();
-	byte hour = getSunsetHour(daynum);
-	byte min = getSunsetMinute(daynum);
-	m_addMinutes(hour, min, m_timezone*60 + m_closeDelay);
+	Time currentTime = m_rtc->getTime();
+	m_compile(currentTime);
+	int minute = m_schedule.next(currentTime.hour*60 + currentTime.min, false);
+	if (minute < 0)
+		return "--:--";
 
-	char str[5];
-	sprintf(str, "%02d:%02d", hour, min);
+	char str[6];
+	m_formatMinute(str, minute);
 	return str;
 }
 
-void Clock::printOpenTime(LiquidCrystal_I2C* lcd) const
+void Clock::printOpenTime(LiquidCrystal_I2C* lcd)
 {
-	int daynum = m_getDayNum();
-	byte hour = getSunriseHour(daynum);
-	byte min = getSunriseMinute(daynum);
-	m_addMinutes(hour, min, m_timezone*60 + m_openDelay);
-
-	char str[5];
-	sprintf(str, "%02d:%02d", hour, min);
+	char str[6];
+	m_formatMinute(str, m_sunrise(m_getDayNum()) + m_openDelay);
 	lcd->print(str);
 }
 
-void Clock::printCloseTime(LiquidCrystal_I2C* lcd) const
+void Clock::printCloseTime(LiquidCrystal_I2C* lcd)
 {
-	int daynum = m_getDayNum();
-	byte hour = getSunsetHour(daynum);
-	byte min = getSunsetMinute(daynum);
-	m_addMinutes(hour, min, m_timezone*60 + m_closeDelay);
-
-	char str[5];
-	sprintf(str, "%02d:%02d", hour, min);
+	char str[6];
+	m_formatMinute(str, m_sunset(m_getDayNum()) + m_closeDelay);
 	lcd->print(str);
 }
 
@@ -281,34 +656,48 @@ bool Clock::sunsetListener()
 	return (last && !current);
 }
 
-// Sunrise time is included in day, sunset time is included in night
-bool Clock::isDay()
+// The constructor runs before the settings are loaded, so it may have seen the wrong time zone and delays
+void Clock::resetListeners(bool day)
 {
-	int daynum = m_getDayNum();
-	byte riseHour = getSunriseHour(daynum);
-	byte riseMin = getSunriseMinute(daynum);
-	byte setHour = getSunsetHour(daynum);
-	byte setMin = getSunsetMinute(daynum);
-	m_addMinutes(riseHour, riseMin, m_timezone*60 + m_openDelay);
-	m_addMinutes(setHour, setMin, m_timezone*60 + m_closeDelay);
+	m_lastReading_riseListener = day;
+	m_lastReading_setListener = day;
+}
 
+// The last transition of a day is always numbered SCHEDULE_MAX_RULES - 1, so that before the first one of today,
+// the latest is yesterday's last whatever the number of transitions yesterday.
+uint32_t Clock::lastTransition()
+{
 	Time currentTime = m_rtc->getTime();
+	uint32_t first = (uint32_t)m_compile(currentTime) * SCHEDULE_MAX_RULES;
+	byte passed = m_schedule.passed(currentTime.hour*60 + currentTime.min);
+	if (passed == 0)
+		return first - 1;
+	if (passed == m_schedule.count())
+		return first + SCHEDULE_MAX_RULES - 1;
+	return first + passed - 1;
+}
 
-	// compare hours first
-	if (currentTime.hour > riseHour && currentTime.hour < setHour)
-	{
+// Nothing saved (first boot, a blank EEPROM, or a record from before the schedule) counts as missed
+bool Clock::transitionMissed()
+{
+	uint32_t followed;
+	if (m_transitionJournal.load(&followed, sizeof(followed)) != sizeof(followed))
 		return true;
-	}
-	else if (currentTime.hour == riseHour)
-	{
-		return (currentTime.min >= riseMin);
-	}
-	else if (currentTime.hour == setHour)
-	{
-		return (currentTime.min < setMin);
-	}
-	
-	return false;
+	return (int32_t)(lastTransition() - followed) > 0;
+}
+
+void Clock::recordTransition()
+{
+	uint32_t transition = lastTransition();
+	m_transitionJournal.save(&transition, sizeof(transition));
+}
+
+// A transition's minute is included in what it switches to: sunrise time is day, sunset time is night
+bool Clock::isDay()
+{
+	Time currentTime = m_rtc->getTime();
+	m_compile(currentTime);
+	return m_schedule.isOpen(currentTime.hour*60 + currentTime.min);
 }
 
 bool Clock::isNight()
@@ -318,9 +707,14 @@ bool Clock::isNight()
 
 int Clock::m_getDayNum()
 {
-	byte day = getDay();
-	byte month = getMonth();
+	Time currentTime = m_rtc->getTime();
+	return m_getDayNum(currentTime.date, currentTime.mon);
+}
 
+// Row of the sun tables. They have one for February 29th, so February always counts 29 days here and other years
+// skip that row.
+int Clock::m_getDayNum(byte day, byte month) const
+{
 	switch (month)
 	{
 		case 1:
@@ -328,461 +722,362 @@ int Clock::m_getDayNum()
 		case 2:
 			return 31 + day;
 		case 3:
-			return 31 + 28 + day;
+			return 31 + 29 + day;
 		case 4:
-			return 31 + 28 + 31 + day;
+			return 31 + 29 + 31 + day;
 		case 5:
-			return 31 + 28 + 31 + 30 + day;
+			return 31 + 29 + 31 + 30 + day;
 		case 6:
-			return 31 + 28 + 31 + 30 + 31 + day;
+			return 31 + 29 + 31 + 30 + 31 + day;
 		case 7:
-			return 31 + 28 + 31 + 30 + 31 + 30 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + day;
 		case 8:
-			return 31 + 28 + 31 + 30 + 31 + 30 + 31 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + 31 + day;
 		case 9:
-			return 31 + 28 + 31 + 30 + 31 + 30 + 31 + 31 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + 31 + 31 + day;
 		case 10:
-			return 31 + 28 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + day;
 		case 11:
-			return 31 + 28 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + 31 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + 31 + day;
 		case 12:
-			return 31 + 28 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + 31 + 30 + day;
+			return 31 + 29 + 31 + 30 + 31 + 30 + 31 + 31 + 30 + 31 + 30 + day;
 		default:
 			return 1;
 	}
 }
 
+unsigned int Clock::m_daysSince2000(const Time& t) const
+{
+	unsigned int year = t.year - 2000;
+	unsigned int days = year*365 + (year + 3)/4 + m_getDayNum(t.date, t.mon) - 1; // leap days of the years before this one
+	if (!m_isLeapYear(t.year) && t.mon > 2)
+		days--; // the row of February 29th
+	return days;
+}
+
+// Compiles the schedule for the day of t, unless it already is. Returns the day (since 2000).
+unsigned int Clock::m_compile(const Time& t)
+{
+	unsigned int days = m_daysSince2000(t);
+	if (m_schedule.compiled(days))
+		return days;
+
+	int daynum = m_getDayNum(t.date, t.mon);
+	int daynum_before = (daynum > 1) ? daynum - 1 : 366; // entry 0 of the sun tables is not a day
+	if (daynum_before == CLOCK_FEB_29 && !m_isLeapYear(t.year))
+		daynum_before--;
+	byte weekday = (days + 6) % 7; // 1 January 2000 was a Saturday
+	m_schedule.compile(days, weekday, m_sunrise(daynum), m_sunset(daynum), m_sunrise(daynum_before), m_sunset(daynum_before));
+	return days;
+}
+
+// In minutes of the day, local time
+int Clock::m_sunrise(int daynum) const
+{
+	return getSunriseHour(daynum)*60 + getSunriseMinute(daynum) + m_timezone*60;
+}
+
+int Clock::m_sunset(int daynum) const
+{
+	return getSunsetHour(daynum)*60 + getSunsetMinute(daynum) + m_timezone*60;
+}
+
 float Clock::getTemp() const
 {
 	return m_rtc->getTemp();
 }
 
-void Clock::m_addMinutes(byte &hour, byte &minute, int add)
+// "hh:mm" into str (6 chars). A delay or time zone can take minute out of the day, so it is wrapped back into it.
+void Clock::m_formatMinute(char* str, int minute)
 {
-	int minutes = hour*60 + minute + add;
-	hour = minutes / 60;
-	minute = minutes % 60;
+	minute %= MINUTES_PER_DAY;
+	if (minute < 0)
+		minute += MINUTES_PER_DAY;
+	byte hour = minute / 60;
+	minute %= 60;
+	str[0] = '0' + hour / 10;
+	str[1] = '0' + hour % 10;
+	str[2] = ':';
+	str[3] = '0' + minute / 10;
+	str[4] = '0' + minute % 10;
+	str[5] = '\0';
 }
 
 /****************************************************************/
 /*						DISPLAY									*/
 /****************************************************************/
-Display::Display(LiquidCrystal_I2C* lcd, Door* door, Clock* cl, Button* rb, Button* lb) : m_currentMenu(OFF), m_lcd(lcd), m_door(door),
-m_clock(cl), m_rightButton(rb), m_leftButton(lb), m_lastActive(millis())
+Display::Display(LiquidCrystal_I2C* lcd, DoorGroup* doors, Clock* cl, Settings* s, Button* rb, Button* lb) : m_currentMenu(OFF), m_lcd(lcd), m_doors(doors), m_door(doors->get(0)),
+m_clock(cl), m_settings(s), m_rightButton(rb), m_leftButton(lb), m_lastActive(millis()), m_sequence(SEQUENCE_NONE), m_heldButton(rb)
 {}
 
-// right click cycles through menus
-void Display::rightClick()
+void Display::splash()
 {
-	m_lastActive = millis();
-	switch (m_currentMenu)
-	{
-		case OFF:
-			m_lcd->display();
-			m_lcd->backlight();
-			m_currentMenu = DOOR_STATUS;
-			break;
-
-		case DOOR_STATUS:
-			m_currentMenu = TEMP_AND_DATE;
-			break;
-
-		case TEMP_AND_DATE:
-			m_currentMenu = DOOR_STATUS;
-			break;
-
-		case DOOR_MODIFY:
-			m_currentMenu = DOOR_MANUAL_MODIFY;
-			break;
-
-		case DOOR_MANUAL_MODIFY:
-			m_currentMenu = DOOR_CALIBRATE;
-			break;
-
-		case DOOR_CALIBRATE:
-			m_currentMenu = OPEN_DELAY_MODIFY;
-			break;
-
-		case OPEN_DELAY_MODIFY:
-			m_currentMenu = CLOSE_DELAY_MODIFY;
-			break;
-
-		case CLOSE_DELAY_MODIFY:
-			m_currentMenu = TIMEZONE_MODIFY;
-			break;
-
-		case TIMEZONE_MODIFY:
-			m_currentMenu = TIME_MODIFY;
-			break;
-
-		case TIME_MODIFY:
-			m_currentMenu = DATE_MODIFY;
-			break;
-
-		case DATE_MODIFY:
-			m_currentMenu = DOOR_MODIFY;
+	printMessage(m_lcd, WELCOME_MSG);
+	m_lcd->setCursor(0, 1);
+	m_lcd->print(F("  Ardugallino   "));
+	m_sequence = SEQUENCE_SPLASH;
+}
 
-		case OPEN_DELAY_COUNTER:
-			m_clock->setOpenDelay(m_clock->getOpenDelay() + 1);
-			break;
+// Each sequence is written out in the order it happens. When it is over, the menu is drawn again (and woken up
+// if the display was off, as it is at boot).
+bool Display::run()
+{
+	TASK_BEGIN(m_task);
+	if (m_sequence == SEQUENCE_SPLASH)
+	{
+		TASK_DELAY(m_task, SPLASH_TIME);
+	}
+	else if (m_sequence == SEQUENCE_CALIBRATION)
+	{
+		// The door shows "Calibration complete" (or "failed") once it reaches the limit switch
+		TASK_WAIT_UNTIL(m_task, !m_door->moving());
+		TASK_DELAY(m_task, CALIBRATION_MESSAGE_TIME);
+		if (!m_door->calibrationFailed())
+		{
+			printMessage(m_lcd, DOOR_STEPS_MSG);
+			m_lcd->setCursor(0, 1);
+			m_lcd->print(m_door->getStepsToClose());
+			m_lcd->print(F(" ("));
+			m_lcd->print(m_door->getHomingCoarse());
+			m_lcd->print('/');
+			m_lcd->print(m_door->getHomingFine());
+			m_lcd->print(')');
+			TASK_DELAY(m_task, CALIBRATION_MESSAGE_TIME);
+		}
+		m_door->unBlock();
+	}
+	else if (m_sequence == SEQUENCE_MANUAL_OPEN || m_sequence == SEQUENCE_MANUAL_CLOSE)
+	{
+		m_door->startManualMove(m_sequence == SEQUENCE_MANUAL_OPEN);
+		while (m_heldButton->isPressed())
+		{
+			m_manualMove();
+			TASK_YIELD(m_task);
+		}
+		m_door->endManualMove();
+	}
+	else
+		return true;
 
-		case CLOSE_DELAY_COUNTER:
-			m_clock->setCloseDelay(m_clock->getCloseDelay() + 1);
-			break;
+	m_sequence = SEQUENCE_NONE;
+	if (m_currentMenu == OFF)
+		rightClick();
+	else
+		m_display();
+	TASK_END(m_task);
+}
 
-		case TIMEZONE_COUNTER:
-			m_clock->setTimezone(m_clock->getTimezone() + 1);
-			break;
+void Display::rightClick() {m_handle(RIGHT_CLICK);}
+void Display::leftClick() {m_handle(LEFT_CLICK);}
+void Display::rightDoubleClick() {m_handle(RIGHT_DOUBLE_CLICK);}
+void Display::leftDoubleClick() {m_handle(LEFT_DOUBLE_CLICK);}
+void Display::rightLongClick() {m_handle(RIGHT_LONG_CLICK);}
+void Display::leftLongClick() {m_handle(LEFT_LONG_CLICK);}
 
-		case HOURS_COUNTER:
-			m_clock->setTime(m_clock->getHour() + 1, m_clock->getMin());
-			break;
-
-		case MINUTES_COUNTER:
-			m_clock->setTime(m_clock->getHour(), m_clock->getMin() + 1);
-			break;
+// Looks up the gesture in menuTable (see Menus.cpp), moves to the next menu and does the action
+void Display::m_handle(Gesture g)
+{
+	m_lastActive = millis();
+	if (m_sequence != SEQUENCE_NONE)
+		return;
 
-		case YEAR_COUNTER:
-			m_clock->setDate(m_clock->getYear() + 1, m_clock->getMonth(), m_clock->getDay());
-			break;
+	MenuTransition t;
+	memcpy_P(&t, &menuTable[m_currentMenu][g], sizeof(t));
+	m_currentMenu = (Menu)t.next;
 
-		case MONTH_COUNTER:
-			m_clock->setDate(m_clock->getYear(), m_clock->getMonth() + 1, m_clock->getDay());
-			break;
+	// With a single door there is nothing to select, so its menu is passed over in the same direction
+	if (m_currentMenu == DOOR_SELECT && m_doors->count() < 2)
+	{
+		memcpy_P(&t, &menuTable[DOOR_SELECT][g], sizeof(t));
+		m_currentMenu = (Menu)t.next;
+	}
 
-		case DAY_COUNTER:
-			m_clock->setDate(m_clock->getYear(), m_clock->getMonth(), m_clock->getDay() + 1);
-			break;
+	m_doAction(t.action);
 
-		default:
-			break;
-	}
 	m_display();
 }
 
-// left click cycles through menus
-void Display::leftClick()
+void Display::m_doAction(byte action)
 {
-	m_lastActive = millis();
-	switch (m_currentMenu)
+	switch (action)
 	{
-		case OFF:
+		case WAKE_UP:
 			m_lcd->display();
 			m_lcd->backlight();
-			m_currentMenu = DOOR_STATUS;
-			break;
-
-		case DOOR_STATUS:
-			m_currentMenu = TEMP_AND_DATE;
-			break;
-
-		case TEMP_AND_DATE:
-			m_currentMenu = DOOR_STATUS;
-			break;
-
-		case DOOR_MODIFY:
-			m_currentMenu = DATE_MODIFY;
 			break;
 
-		case DOOR_MANUAL_MODIFY:
-			m_currentMenu = DOOR_MODIFY;
+		case TOGGLE_DOOR:
+			if (m_door->isOpen())
+				m_door->startClose();
+			else
+				m_door->startOpen();
 			break;
 
-		case DOOR_CALIBRATE:
-			m_currentMenu = DOOR_MANUAL_MODIFY;
+		case START_CALIBRATION:
+			m_door->block();
 			break;
 
-		case OPEN_DELAY_MODIFY:
-			m_currentMenu = DOOR_CALIBRATE;
+		case CANCEL_CALIBRATION:
+			m_door->unBlock();
 			break;
 
-		case CLOSE_DELAY_MODIFY:
-			m_currentMenu = OPEN_DELAY_MODIFY;
+		case CALIBRATE:
+			m_door->startCalibrate();
+			m_sequence = SEQUENCE_CALIBRATION;
 			break;
 
-		case TIMEZONE_MODIFY:
-			m_currentMenu = CLOSE_DELAY_MODIFY;
+		case MANUAL_OPEN:
+			m_heldButton = m_rightButton;
+			m_sequence = SEQUENCE_MANUAL_OPEN;
 			break;
 
-		case TIME_MODIFY:
-			m_currentMenu = TIMEZONE_MODIFY;
+		case MANUAL_CLOSE:
+			m_heldButton = m_leftButton;
+			m_sequence = SEQUENCE_MANUAL_CLOSE;
 			break;
 
-		case DATE_MODIFY:
-			m_currentMenu = TIME_MODIFY;
+		case OPEN_DELAY_UP:
+			m_clock->setOpenDelay(m_clock->getOpenDelay() + 1);
 			break;
 
-		case OPEN_DELAY_COUNTER:
+		case OPEN_DELAY_DOWN:
 			m_clock->setOpenDelay(m_clock->getOpenDelay() - 1);
 			break;
 
-		case CLOSE_DELAY_COUNTER:
-			m_clock->setCloseDelay(m_clock->getCloseDelay() - 1);
-			break;
-
-		case TIMEZONE_COUNTER:
-			m_clock->setTimezone(m_clock->getTimezone() - 1);
-			break;
-
-		case HOURS_COUNTER:
-			m_clock->setTime(m_clock->getHour() - 1, m_clock->getMin());
-			break;
-
-		case MINUTES_COUNTER:
-			m_clock->setTime(m_clock->getHour(), m_clock->getMin() - 1);
-			break;
-
-		case YEAR_COUNTER:
-			m_clock->setDate(m_clock->getYear() - 1, m_clock->getMonth(), m_clock->getDay());
-			break;
-
-		case MONTH_COUNTER:
-			m_clock->setDate(m_clock->getYear(), m_clock->getMonth() - 1, m_clock->getDay());
+		case SAVE_OPEN_DELAY:
+			m_settings->setOpenDelay(m_clock->getOpenDelay());
+			m_settings->requestCommit();
 			break;
 
-		case DAY_COUNTER:
-			m_clock->setDate(m_clock->getYear(), m_clock->getMonth(), m_clock->getDay() - 1);
+		case CLOSE_DELAY_UP:
+			m_clock->setCloseDelay(m_clock->getCloseDelay() + 1);
 			break;
 
-		default:
+		case CLOSE_DELAY_DOWN:
+			m_clock->setCloseDelay(m_clock->getCloseDelay() - 1);
 			break;
-	}
-	m_display();
-}
 
-// right double click enters a submenu
-void Display::rightDoubleClick()
-{
-	m_lastActive = millis();
-	switch (m_currentMenu)
-	{
-		case OFF:
-			rightClick();
+		case SAVE_CLOSE_DELAY:
+			m_settings->setCloseDelay(m_clock->getCloseDelay());
+			m_settings->requestCommit();
 			break;
 
-		case DOOR_STATUS:
-			m_currentMenu = OPEN_DELAY_MODIFY;
+		case TIMEZONE_UP:
+			m_clock->setTimezone(m_clock->getTimezone() + 1);
 			break;
 
-		default:
+		case TIMEZONE_DOWN:
+			m_clock->setTimezone(m_clock->getTimezone() - 1);
 			break;
-	}
-	m_display();
-}
 
-// left double click leaves the submenu
-void Display::leftDoubleClick()
-{
-	m_lastActive = millis();
-	switch (m_currentMenu)
-	{
-		case OFF:
-			leftClick();
+		case SAVE_TIMEZONE:
+			m_settings->setTimezone(m_clock->getTimezone());
+			m_settings->requestCommit();
 			break;
 
-		case DOOR_STATUS:	// Fallthrough intentional
-		case TEMP_AND_DATE:
-			m_currentMenu = OFF;
+		case HOUR_UP:
+			m_clock->setTime(m_clock->getHour() + 1, m_clock->getMin());
 			break;
 
-		case DOOR_MODIFY:
-		case DOOR_MANUAL_MODIFY:
-		case DOOR_CALIBRATE:
-		case OPEN_DELAY_MODIFY:
-		case CLOSE_DELAY_MODIFY:
-		case TIMEZONE_MODIFY:
-		case TIME_MODIFY:
-		case DATE_MODIFY:
-			m_currentMenu = DOOR_STATUS;
+		case HOUR_DOWN:
+			m_clock->setTime(m_clock->getHour() - 1, m_clock->getMin());
 			break;
 
-		case CALIBRATION_WAIT:
-			m_currentMenu = DOOR_CALIBRATE;
+		case MINUTE_UP:
+			m_clock->setTime(m_clock->getHour(), m_clock->getMin() + 1);
 			break;
 
-		case OPEN_DELAY_COUNTER:
-			m_currentMenu = OPEN_DELAY_MODIFY;
+		case MINUTE_DOWN:
+			m_clock->setTime(m_clock->getHour(), m_clock->getMin() - 1);
 			break;
 
-		case CLOSE_DELAY_COUNTER:
-			m_currentMenu = CLOSE_DELAY_MODIFY;
+		case YEAR_UP:
+			m_clock->setDate(m_clock->getYear() + 1, m_clock->getMonth(), m_clock->getDay());
 			break;
 
-		case TIMEZONE_COUNTER:
-			m_currentMenu = TIMEZONE_MODIFY;
+		case YEAR_DOWN:
+			m_clock->setDate(m_clock->getYear() - 1, m_clock->getMonth(), m_clock->getDay());
 			break;
 
-		case HOURS_COUNTER:
-			m_currentMenu = TIME_MODIFY;
+		case MONTH_UP:
+			m_clock->setDate(m_clock->getYear(), m_clock->getMonth() + 1, m_clock->getDay());
 			break;
 
-		case MINUTES_COUNTER:
-			m_currentMenu = HOURS_COUNTER;
+		case MONTH_DOWN:
+			m_clock->setDate(m_clock->getYear(), m_clock->getMonth() - 1, m_clock->getDay());
 			break;
 
-		case YEAR_COUNTER:
-			m_currentMenu = DATE_MODIFY;
+		case DAY_UP:
+			m_clock->setDate(m_clock->getYear(), m_clock->getMonth(), m_clock->getDay() + 1);
 			break;
 
-		case MONTH_COUNTER:
-			m_currentMenu = YEAR_COUNTER;
+		case DAY_DOWN:
+			m_clock->setDate(m_clock->getYear(), m_clock->getMonth(), m_clock->getDay() - 1);
 			break;
 
-		case DAY_COUNTER:
-			m_currentMenu = MONTH_COUNTER;
+		case SELECT_DOOR:
+			m_door = m_doors->get((m_door->getIndex() + 1) % m_doors->count());
 			break;
 
 		default:
-			m_currentMenu = DOOR_STATUS;
 			break;
 	}
-	m_display();
 }
 
-// right long click opens/closes door; enters/confirms chicken count/light level change
-void Display::rightLongClick()
+// The messages of a sequence or of a moving door stay up until it is over
+void Display::m_display()
 {
-	m_lastActive = millis();
-	switch (m_currentMenu)
-	{
-		case OFF:
-			turnOff();
-			break;
-
-		case DOOR_MODIFY:
-			if (m_door->isOpen())
-				m_door->close();
-			else
-				m_door->open();
-
-			break;
-
-		case DOOR_CALIBRATE:
-			m_currentMenu = CALIBRATION_WAIT;
-			m_door->block();
-			break;
-
-		case CALIBRATION_WAIT:
-			m_door->calibrate();
-			m_currentMenu = DOOR_STATUS;
-			delay(2000);
-			m_door->unBlock();
-			break;
-
-		case DOOR_MANUAL_MODIFY:
-			while (m_rightButton->isPressed())
-			{
-				m_door->openSteps(1);
-			}
-			break;
-
-		case OPEN_DELAY_MODIFY:
-			m_currentMenu = OPEN_DELAY_COUNTER;
-			break;
-
-		case CLOSE_DELAY_MODIFY:
-			m_currentMenu = CLOSE_DELAY_COUNTER;
-			break;
-
-		case OPEN_DELAY_COUNTER:
-			EEPROM.put(OPEN_DELAY_EEPROM_ADDR, m_clock->getOpenDelay());
-			m_currentMenu = OPEN_DELAY_MODIFY;
-			break;
-
-		case CLOSE_DELAY_COUNTER:
-			EEPROM.put(CLOSE_DELAY_EEPROM_ADDR, m_clock->getCloseDelay());
-			m_currentMenu = CLOSE_DELAY_MODIFY;
-			break;
-
-		case TIMEZONE_MODIFY:
-			m_currentMenu = TIMEZONE_COUNTER;
-			break;
-
-		case TIMEZONE_COUNTER:
-			EEPROM.put(TIMEZONE_EEPROM_ADDR, m_clock->getTimezone());
-			m_currentMenu = TIMEZONE_MODIFY;
-			break;
-
-		case TIME_MODIFY:
-			m_currentMenu = HOURS_COUNTER;
-			break;
-
-		case HOURS_COUNTER:
-			m_currentMenu = MINUTES_COUNTER;
-			break;
-
-		case MINUTES_COUNTER:
-			m_currentMenu = TIME_MODIFY;
-			break;
-
-		case DATE_MODIFY:
-			m_currentMenu = YEAR_COUNTER;
-			break;
-
-		case YEAR_COUNTER:
-			m_currentMenu = MONTH_COUNTER;
-			break;
-
-		case MONTH_COUNTER:
-			m_currentMenu = DAY_COUNTER;
-			break;
-
-		case DAY_COUNTER:
-			m_currentMenu = DATE_MODIFY;
-			break;
-
-		default:
-			break;
-	}
-	m_display();
+	if (m_sequence != SEQUENCE_NONE || m_doors->moving())
+		return;
+	m_display(m_currentMenu);
 }
 
-void Display::leftLongClick()
+// Steps for up to DOOR_RUN_SLICE while the button is held
+void Display::m_manualMove()
 {
-	m_lastActive = millis();
-	switch (m_currentMenu)
+	unsigned long start = micros();
+	while (m_heldButton->isPressed() && micros() - start < DOOR_RUN_SLICE * 1000UL)
 	{
-		case DOOR_MANUAL_MODIFY:
-			while (m_leftButton->isPressed())
-			{
-				m_door->closeSteps(1);
-			}
-			break;
-
-		case CALIBRATION_WAIT:
-			while (m_leftButton->isPressed())
-			{
-				m_door->closeSteps(1);
-			}
-
-		default:
-			break;
+		if (m_sequence == SEQUENCE_MANUAL_OPEN)
+			m_door->openSteps(1);
+		else
+			m_door->closeSteps(1);
 	}
-	m_display();
-}
-
-void Display::m_display()
-{
-	m_display(m_currentMenu);
 }
 
+// Draws a menu from its entry in menuScreens (see Menus.cpp)
 void Display::m_display(Menu m)
 {
-	switch (m)
+	MenuScreen screen;
+	memcpy_P(&screen, &menuScreens[m], sizeof(screen));
+
+	switch (screen.layout)
 	{
-		case OFF:
+		case SCREEN_OFF:
 			turnOff();
 			break;
 
-		case DOOR_STATUS:
-			if (m_door->isOpen())
-				printMessage(m_lcd, DOOR_OPEN_MSG);
+		case SCREEN_DOOR_STATUS:
+			if (m_doors->count() > 1)
+				m_printDoors();
 			else
-				printMessage(m_lcd, DOOR_CLOSED_MSG);
+			{
+				if (m_door->isOpen())
+					printMessage(m_lcd, DOOR_OPEN_MSG);
+				else
+					printMessage(m_lcd, DOOR_CLOSED_MSG);
+
+				// Door needs checking (or recalibrating)
+				if (m_door->getStats().drifting())
+				{
+					m_lcd->setCursor(15, 0);
+					m_lcd->print(F("!"));
+				}
+			}
 
 			m_lcd->setCursor(0, 1);
 
-			if (m_door->isOpen())
+			if (m_doors->anyOpen())
 			{
 				m_lcd->print(F("Closes at "));
 				m_lcd->print(m_clock->getCloseTimeStr());
@@ -795,7 +1090,7 @@ void Display::m_display(Menu m)
 
 			break;
 
-		case TEMP_AND_DATE:
+		case SCREEN_TEMP_AND_DATE:
 			m_lcd->clear();
 			m_lcd->print(F("   "));
 			m_lcd->print(m_clock->getDateStr());
@@ -809,8 +1104,27 @@ void Display::m_display(Menu m)
 
 			break;
 
-		case DOOR_MODIFY:
-			printMessage(m_lcd, HOLD_R_MSG);
+		case SCREEN_METRICS:
+		{
+			const MetricsData& data = metrics.get();
+			m_lcd->clear();
+			m_lcd->print(F("Moves "));
+			m_lcd->print(data.opens);
+			m_lcd->print('/');
+			m_lcd->print(data.closes);
+			m_lcd->setCursor(0, 1);
+			m_lcd->print(F("Rst"));
+			m_lcd->print(metrics.resets());
+			m_lcd->print(F(" Err"));
+			m_lcd->print(data.timeouts + data.i2cErrors);
+			m_lcd->print(' ');
+			m_lcd->print(data.uptime / 86400UL);
+			m_lcd->print('d');
+			break;
+		}
+
+		case SCREEN_DOOR_MODIFY:
+			printMessage(m_lcd, screen.line0);
 			m_lcd->setCursor(0, 1);
 			if (m_door->isOpen())
 				printMessage(m_lcd, OPEN_DOOR_MSG, false);
@@ -819,146 +1133,115 @@ void Display::m_display(Menu m)
 
 			break;
 
-		case DOOR_MANUAL_MODIFY:
-			m_lcd->clear();
-			m_lcd->print(F("Hold R/L for ma-"));
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("nual open/close."));
-			break;
-
-		case DOOR_CALIBRATE:
-			printMessage(m_lcd, HOLD_R_MSG);
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("calibrate door."));
-			break;
-
-		case CALIBRATION_WAIT:
-			m_lcd->clear()	;
-			m_lcd->print(F("Close door. Hold"));
+		case SCREEN_TEXT:
+			printMessage(m_lcd, screen.line0);
 			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("R to continue."));
+			printMessage(m_lcd, screen.line1, false);
 			break;
 
-		case OPEN_DELAY_MODIFY:
-			printMessage(m_lcd, HOLD_R_MSG);
-			m_lcd->print(F(" change"));
+		case SCREEN_SETTING:
+			printMessage(m_lcd, screen.line0);
 			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("open delay ("));
-			m_lcd->print(m_clock->getOpenDelay());
+			printMessage(m_lcd, screen.line1, false);
+			m_printValue(screen.value);
 			m_lcd->print(F(")"));
 			break;
 
-		case CLOSE_DELAY_MODIFY:
-			printMessage(m_lcd, HOLD_R_MSG);
-			m_lcd->print(F(" change"));
+		case SCREEN_COUNTER:
+			printMessage(m_lcd, LEFT_ARROW_MSG);
+			m_printValue(screen.value);
+			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
 			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("close delay("));
-			m_lcd->print(m_clock->getCloseDelay());
-			m_lcd->print(F(")"));
+			printMessage(m_lcd, screen.line1, false);
 			break;
 
-		case OPEN_DELAY_COUNTER:
+		case SCREEN_DELAY_COUNTER:
 			m_lcd->clear();
 			m_lcd->print(F("  <"));
-			m_lcd->print(m_clock->getOpenDelay());
+			m_printValue(screen.value);
 			m_lcd->print(F(">  "));
-			m_clock->printOpenTime(m_lcd);
+			if (screen.value == OPEN_DELAY_VALUE)
+				m_clock->printOpenTime(m_lcd);
+			else
+				m_clock->printCloseTime(m_lcd);
 			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
+			printMessage(m_lcd, screen.line1, false);
 			break;
 
-		case CLOSE_DELAY_COUNTER:
+		default:
 			m_lcd->clear();
-			m_lcd->print(F("  <"));
-			m_lcd->print(m_clock->getCloseDelay());
-			m_lcd->print(F(">  "));
-			m_clock->printCloseTime(m_lcd);
+			m_lcd->print(F("Menu not yet"));
 			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
+			m_lcd->print(F("available."));
 			break;
+	}
+}
 
-		case TIMEZONE_MODIFY:
-			m_lcd->clear();
-			m_lcd->print(F("Hold R to change"));
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("timezone ("));
-			m_lcd->print(m_clock->getTimezone());
-			m_lcd->print(F(")"));
+void Display::m_printValue(byte value)
+{
+	switch (value)
+	{
+		case OPEN_DELAY_VALUE:
+			m_lcd->print(m_clock->getOpenDelay());
 			break;
 
-		case TIMEZONE_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
+		case CLOSE_DELAY_VALUE:
+			m_lcd->print(m_clock->getCloseDelay());
+			break;
+
+		case TIMEZONE_VALUE:
 			m_lcd->print(m_clock->getTimezone());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
 			break;
 
-		case TIME_MODIFY:
-			m_lcd->clear();
-			m_lcd->print(F("Hold R to change"));
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("time ("));
+		case TIME_VALUE:
 			m_lcd->print(m_clock->getTimeStr());
-			m_lcd->print(F(")"));
 			break;
 
-		case HOURS_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
-			m_lcd->print(m_clock->getHour());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
+		case DATE_VALUE:
+			m_lcd->print(m_clock->getDateStr());
 			break;
 
-		case MINUTES_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
-			m_lcd->print(m_clock->getMin());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
+		case HOUR_VALUE:
+			m_lcd->print(m_clock->getHour());
 			break;
 
-		case DATE_MODIFY:
-			m_lcd->clear();
-			m_lcd->print(F("Hold R to change"));
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("date("));
-			m_lcd->print(m_clock->getDateStr());
-			m_lcd->print(F(")"));
+		case MINUTE_VALUE:
+			m_lcd->print(m_clock->getMin());
 			break;
 
-		case YEAR_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
+		case YEAR_VALUE:
 			m_lcd->print(m_clock->getYear());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
 			break;
 
-		case MONTH_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
+		case MONTH_VALUE:
 			m_lcd->print(m_clock->getMonth());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
 			break;
 
-		case DAY_COUNTER:
-			printMessage(m_lcd, LEFT_ARROW_MSG);
+		case DAY_VALUE:
 			m_lcd->print(m_clock->getDay());
-			printMessage(m_lcd, RIGHT_ARROW_MSG, false);
-			m_lcd->setCursor(0, 1);
-			printMessage(m_lcd, HOLD_R_SAVE_MSG, false);
+			break;
+
+		case DOOR_VALUE:
+			m_lcd->print(m_door->getIndex() + 1);
 			break;
 
 		default:
-			m_lcd->clear();
-			m_lcd->print(F("Menu not yet"));
-			m_lcd->setCursor(0, 1);
-			m_lcd->print(F("available."));
 			break;
+	}
+}
 
+// One letter per door (O = open, C = closed), followed by "!" if the door needs checking
+void Display::m_printDoors()
+{
+	m_lcd->clear();
+	m_lcd->print(F("Doors:"));
+	for (byte i = 0; i < m_doors->count(); i++)
+	{
+		Door* door = m_doors->get(i);
+		m_lcd->print(F(" "));
+		m_lcd->print(door->isOpen() ? F("O") : F("C"));
+		if (door->getStats().drifting())
+			m_lcd->print(F("!"));
 	}
 }
 
@@ -2,12 +2,21 @@
 #define CLASSES_H
 
 #include <arduino.h>
+#include "Profile.h"
+#include "FastPin.h"
+#include "DoorStats.h"
+#include "Journal.h"
+#include "Schedule.h"
+#include "Menus.h"
+#include "Task.h"
 
 #define signed_byte int8_t // equivalent to 'char' but more clear
 
-class Stepper;
+class StepperDriver;
 class LiquidCrystal_I2C;
-class DS3231;
+class Rtc;
+struct Time;
+class Settings;
 
 //--------------------------------------------------------------------
 class Button
@@ -15,49 +24,172 @@ class Button
 public:
 	Button(byte pin) : m_pin(pin)
 	{
-		digitalWrite(m_pin, LOW);
-		pinMode(m_pin, INPUT);
+		m_pin.low();
+		m_pin.input();
 	}
 
 	bool isPressed() const;
 
 private:
-	const byte m_pin;
+	Pin m_pin;
 };
 
 //--------------------------------------------------------------------
 #define STEPPER_DIRECTION -1 // Change to -1 to switch open/close directions
 #define MAX_STEPS 65534 // Max steps to take before giving up (currently set to max value of an unsigned int)
 #define RELAY_PIN 13
+#define MOTOR_HOLD_TIME 250 // Coils stay energised this long (in milliseconds) after a move, then the motor is released
+#define DOOR_CLOSE_CHECKPOINTS 4 // Position is saved this many times while closing, so an interrupted close can be finished
+#define DOOR_MIN_CHECKPOINT_STEPS 25
+#define DOOR_RAMP_LENGTH 10 // steps over which the motor speeds up at the start of a move (see doorRamp in Classes.cpp)
+#define DOOR_CHECKPOINT_LEAD 8 // steps before the end of a closing chunk at which the next one is saved (see m_followClose())
+// Calibration homes on the limit switch in two passes: fast until it trips, back off, then slowly onto it again
+#define DOOR_HOMING_FAST_STEP 2500	// (microseconds per step) the top of doorRamp
+#define DOOR_HOMING_SLOW_STEP 10000	// the start of doorRamp
+#define DOOR_HOMING_BACKOFF 20		// steps back off the switch between the passes. Must be more than it takes to release it.
+#define DOOR_RUN_SLICE 20 // (milliseconds) A move steps for this long at a time, then lets loop() run (see DoorGroup::run())
+
+// Motion in progress when the position was saved
+#define DOOR_IDLE 0
+#define DOOR_OPENING 1
+#define DOOR_CLOSING 2
+#define DOOR_CALIBRATING 3	// never saved: the position journal sees it as an opening
+
+// Passes of a calibration
+#define HOMING_FAST 0
+#define HOMING_BACKOFF 1
+#define HOMING_SLOW 2
+
+struct DoorPosition
+{
+	int16_t position;	// steps from the closed position
+	bool open;
+	byte move;
+} __attribute__((packed));
 
 class Door
 {
 public:
-	Door(byte switch_pin, int steps, Stepper* m, LiquidCrystal_I2C* d);
+	Door(byte index, byte switch_pin, int steps, StepperDriver* m, LiquidCrystal_I2C* d, Settings* s);
 	bool isOpen() const {return m_open;}
 	void open(bool override_open = false); // If override_open = true, it does not check whether door is already open
 	void close();
-	void calibrate();
+	// Non-blocking versions, for everything but setup(): the move goes on in DoorGroup::run().
+	// They do nothing if the door is already moving.
+	void startOpen(bool override_open = false);
+	void startClose();
+	void startCalibrate();	// Runs the door to the limit switch from the closed position, counting the steps.
+	unsigned int getHomingCoarse() const {return m_homingCoarse;}	// steps of the fast pass of the last calibration
+	unsigned int getHomingFine() const {return m_homingFine;}		// and of the slow one
+	bool calibrationFailed() const {return m_homingFailed;}	// The last calibration lost the switch, and was not saved.
+	bool moving() const {return m_move != DOOR_IDLE;}
+	// Manual moves: the relay and the coils are switched on once for the whole move, and off by endManualMove(),
+	// which also saves the position.
+	void startManualMove(bool open);
 	void openSteps(int steps);
 	void closeSteps(int steps);
+	void endManualMove();
+	bool restore();			// Loads the saved position. Returns false if there is none.
+	void recover();			// Finishes a move that was interrupted by a reset.
+	bool interrupted() const {return m_interruptedMove != DOOR_IDLE;}
+	int getPosition() const {return m_position;}
+	byte getIndex() const {return m_index;}
+	bool switchPressed() const {return m_switch.read();}
 	void block() {m_blocked = true;}  // blocks door from opening/closing automatically (for calibration)
 	void unBlock() {m_blocked = false;}
 
+	unsigned int getStepsToClose() const {return m_stepsToClose;}
 	void setStepsToClose(unsigned int steps) {m_stepsToClose = steps;}
-	void setDoorState(bool state) {m_open = state;} // true = open, false = closed
+	void setStepModes(byte open_mode, byte close_mode) {m_openMode = open_mode; m_closeMode = close_mode;}
+	void setDoorState(bool state) {m_open = state; m_position = state ? m_stepsToClose : 0;} // true = open, false = closed
+
+	void loadStats() {m_stats.load();}
+	const DoorStats& getStats() const {return m_stats;}
+	unsigned long getCycleEnergy() const {return m_openEnergy + m_closeEnergy;} // in millijoules
 
 private:
-	const byte m_switch_pin;
+	friend class DoorGroup;
+
+	const byte m_index;		// position in the DoorGroup, also picks the door's EEPROM area and calibration
+	Pin m_switch;
 	bool m_open;
 	unsigned int m_stepsToClose;
-	Stepper* m_motor;
-	LiquidCrystal_I2C* m_display;
+	int m_position;			// in steps, 0 = closed, m_stepsToClose = open
+	byte m_interruptedMove;
+	StepperDriver* m_motor;
+	byte m_openMode;		// stepping modes (see StepperDriver.h)
+	byte m_closeMode;
+	unsigned long m_openEnergy;		// estimated energy of the last open and close, in millijoules
+	unsigned long m_closeEnergy;
+	LiquidCrystal_I2C* m_display;	// NULL when the build has no display (see Profile.h)
+	Settings* m_settings;
+	DoorStats m_stats;
+	Journal m_positionJournal;
+	DoorPosition m_lastSaved;
 	bool m_blocked;
+	bool m_relayOn;
+	static byte s_relayUsers;	// the relay is shared by all doors, so it is only turned off once none of them is moving
+
+	// State of the move in progress, advanced one step at a time by m_run()
+	byte m_move;			// DOOR_IDLE, DOOR_OPENING, DOOR_CLOSING or DOOR_CALIBRATING
+	bool m_holding;			// the steps are done and the coils hold the door for MOTOR_HOLD_TIME
+	unsigned long m_holdStart;
+	unsigned int m_moveSteps;
+	unsigned long m_moveStart;
+	bool m_moveTimeout;
+	bool m_wasOpen;
+	int m_startPosition;
+	unsigned int m_chunk;		// closing checkpoint interval (see m_followClose())
+	int m_chunkEnd;			// position saved for the end of the chunk the motor has been given
+	byte m_homing;			// pass of a calibration: HOMING_FAST, HOMING_BACKOFF or HOMING_SLOW
+	unsigned int m_homingCoarse;
+	unsigned int m_homingFine;
+	bool m_homingFailed;
+
+	bool m_run();			// Follows the motor. Returns true once the door has stopped.
+	bool m_beginOpen(bool override_open);	// Returns false if the door does not need to move, otherwise starts the motor.
+	void m_endOpen();
+	bool m_beginClose();
+	void m_followClose(unsigned int taken);
+	void m_nextChunk();
+	void m_endClose();
+	void m_beginCalibrate();
+	bool m_nextHoming();
+	void m_endCalibrate();
+	void m_traceStart(byte move);
 	void m_openRelay();
 	void m_closeRelay();
+	void m_endMove();
+	void m_checkpoint(byte move);
+	void m_savePosition(int position, byte move);
+};
+
+//--------------------------------------------------------------------
+// All the doors of the coop. Their moves run at the same time, giving a step to whichever door's motor is due next,
+// instead of one door after another.
+class DoorGroup
+{
+public:
+	DoorGroup(Door* doors, byte count) : m_doors(doors), m_count(count) {}
+	byte count() const {return m_count;}
+	Door* get(byte i) {return &m_doors[i];}
+	bool anyOpen() const;
+	bool moving() const;
+	void startOpen(bool override_open = false);
+	void startClose();
+	bool run();		// Moves the doors for up to DOOR_RUN_SLICE. Returns true once none of them is moving.
+
+private:
+	Door* m_doors;
+	byte m_count;
 };
 
 //--------------------------------------------------------------------
+#define CLOCK_SUN_RULES 2	// the schedule's first rules: sunrise + open delay, then sunset + close delay
+#define CLOCK_FEB_29 60		// its row in the sun tables (see m_getDayNum())
+
+// "Day" and "night" are when the schedule (see Schedule.h) has the doors open and closed. Without extra rules, that
+// is from sunrise to sunset, moved by the open and close delays.
 class Clock
 {
 public:
@@ -65,6 +197,7 @@ public:
 	void setTimezone(signed_byte tzone);
 	void setTime(byte hour, byte minute);
 	void setDate(int year, byte month, byte day);
+	bool setDateTime(int year, byte month, byte day, byte hour, byte minute, byte second);	// False if the RTC refused it
 	void setOpenDelay(signed_byte delay);
 	void setCloseDelay(signed_byte delay);
 	byte getDay() const;
@@ -74,11 +207,16 @@ public:
 	byte getMin() const;
 	String getTimeStr() const;
 	String getDateStr() const;
-	String getOpenTimeStr() const;
-	String getCloseTimeStr() const;
+	String getOpenTimeStr();		// Next opening (or closing) of the day, or the first one if there are none left
+	String getCloseTimeStr();
+
+	void printOpenTime(LiquidCrystal_I2C* lcd);	// Sunrise and sunset with their delays
+	void printCloseTime(LiquidCrystal_I2C* lcd);
 
-	void printOpenTime(LiquidCrystal_I2C* lcd) const;
-	void printCloseTime(LiquidCrystal_I2C* lcd) const;
+	// Opening and closing times besides sunrise and sunset, e.g. addRule(RULE_TIME, 13*60, false, WEEKDAYS) to close
+	// at 1 pm on weekdays. Returns false if the schedule is full.
+	bool addRule(byte anchor, int minute, bool open, byte days = EVERY_DAY) {return m_schedule.addRule(anchor, minute, open, days);}
+	void clearRules() {m_schedule.clearRules(CLOCK_SUN_RULES);}
 
 	signed_byte getOpenDelay() const {return m_openDelay;}
 	signed_byte getCloseDelay() const {return m_closeDelay;}
@@ -88,27 +226,54 @@ public:
 
 	bool sunriseListener();
 	bool sunsetListener();
+	void resetListeners(bool day);	// Forgets any sunrise or sunset before now
+
+	// Transitions of the schedule are numbered in order, SCHEDULE_MAX_RULES a day since 2000, so that the last one the
+	// doors followed can be kept in EEPROM and compared with the schedule after a loss of power.
+	uint32_t lastTransition();	// The latest opening or closing up to now
+	bool transitionMissed();		// True if there has been one since the last recordTransition()
+	void recordTransition();		// Saves the latest one as followed
 
 	bool isDay();
 	bool isNight();
 
 private:
-	DS3231* m_rtc;
+	Rtc* m_rtc;
 	int m_getDayNum();
 	bool m_lastReading_riseListener; // true for day, false for night
 	bool m_lastReading_setListener;
 	signed_byte m_timezone; // with respect to UTC
 	signed_byte m_openDelay; // in minutes
 	signed_byte m_closeDelay; // in minutes
+	Journal m_transitionJournal;
+	Schedule m_schedule;
 
-	void m_addMinutes(byte &hour, byte &minute, int add);
+	unsigned int m_compile(const Time& t);
+	int m_sunrise(int daynum) const;
+	int m_sunset(int daynum) const;
+	int m_getDayNum(byte day, byte month) const;
+	static bool m_isLeapYear(uint16_t year) {return year % 4 == 0;}	// right from 1901 to 2099
+	unsigned int m_daysSince2000(const Time& t) const;
+	static void m_formatMinute(char* str, int minute);
 };
 
 //--------------------------------------------------------------------
+#define SPLASH_TIME 1500				// (milliseconds) the welcome message is shown this long at boot
+#define CALIBRATION_MESSAGE_TIME 2000	// each of the messages at the end of a calibration is shown this long
+
+// Sequences played by Display::run(), during which the menus are not drawn and gestures are ignored
+#define SEQUENCE_NONE 0
+#define SEQUENCE_SPLASH 1
+#define SEQUENCE_CALIBRATION 2
+#define SEQUENCE_MANUAL_OPEN 3		// the door moves while the button is held
+#define SEQUENCE_MANUAL_CLOSE 4
+
 class Display
 {
 public:
-	Display(LiquidCrystal_I2C* lcd, Door* door, Clock* cl, Button* rb, Button* lb);
+	Display(LiquidCrystal_I2C* lcd, DoorGroup* doors, Clock* cl, Settings* s, Button* rb, Button* lb);
+	void splash();		// Shows the welcome message for SPLASH_TIME, then the door status.
+	bool run();			// Task (see EventHandler::addTask()) that plays the sequences.
 	void rightClick();
 	void leftClick();
 	void rightDoubleClick();
@@ -121,21 +286,32 @@ public:
 	unsigned long timeInactive() {return millis() - m_lastActive;}
 
 private:
-	enum Menu {OFF, DOOR_STATUS, TEMP_AND_DATE, DOOR_MODIFY, DOOR_MANUAL_MODIFY, DOOR_CALIBRATE, OPEN_DELAY_MODIFY, CLOSE_DELAY_MODIFY, CALIBRATION_WAIT, OPEN_DELAY_COUNTER, CLOSE_DELAY_COUNTER, TIMEZONE_MODIFY, TIMEZONE_COUNTER, TIME_MODIFY, DATE_MODIFY, HOURS_COUNTER, MINUTES_COUNTER, YEAR_COUNTER, MONTH_COUNTER, DAY_COUNTER};
 	Menu m_currentMenu;
 
 	LiquidCrystal_I2C* m_lcd;
-	Door* m_door;
+	DoorGroup* m_doors;
+	Door* m_door;			// the door the door menus act on (see DOOR_SELECT)
 	Clock* m_clock;
+	Settings* m_settings;
 
 	Button* m_rightButton;
 	Button* m_leftButton;
 
 	unsigned long m_lastActive;
 
+	byte m_sequence;
+	Task m_task;
+	Button* m_heldButton;	// of a manual move
+
+	void m_handle(Gesture g);
+	void m_manualMove();
+	void m_doAction(byte action);
+
 	// menu display functions
 	void m_display(); // displays current menu
 	void m_display(Menu m);
+	void m_printValue(byte value);
+	void m_printDoors();
 };
 
 #endif // CLASSES_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "DoorStats.h"
+#include "EEPROM_ADDRESSES.h"
+#include "Trace.h"
+
+static_assert(sizeof(DoorStatsData) <= JOURNAL_MAX_DATA(DOOR_STATS_SLOT_SIZE), "DoorStatsData does not fit a door statistics journal slot");
+
+DoorStats::DoorStats(int journal_addr) : m_journal(journal_addr, DOOR_STATS_JOURNAL_SIZE, DOOR_STATS_SLOT_SIZE)
+{
+	memset(&m_data, 0, sizeof(m_data));
+}
+
+void DoorStats::load()
+{
+	if (m_journal.load(&m_data, sizeof(m_data)) != sizeof(m_data))
+		memset(&m_data, 0, sizeof(m_data));
+}
+
+void DoorStats::recordOpen(unsigned int steps, unsigned long duration, bool timeout, unsigned int calibrated_steps)
+{
+	m_record(m_data.open, steps, duration, timeout);
+
+	// The limit switch should trip after the calibrated number of steps. A door that takes noticeably more
+	// (binding, slipping) or fewer (obstruction, bent switch) needs looking at before it stalls.
+	unsigned int tolerance = calibrated_steps / DRIFT_TOLERANCE_DIV;
+	if (tolerance < DRIFT_MIN_TOLERANCE)
+		tolerance = DRIFT_MIN_TOLERANCE;
+
+	unsigned int diff = (steps > calibrated_steps) ? steps - calibrated_steps : calibrated_steps - steps;
+	if (timeout || diff > tolerance)
+	{
+		if (!m_data.drift)
+			trace.record(TRACE_DRIFT, steps);
+		m_data.drift = true;
+	}
+
+	m_journal.save(&m_data, sizeof(m_data));
+}
+
+void DoorStats::recordClose(unsigned int steps, unsigned long duration, bool timeout)
+{
+	m_record(m_data.close, steps, duration, timeout);
+	m_journal.save(&m_data, sizeof(m_data));
+}
+
+void DoorStats::reset()
+{
+	memset(&m_data, 0, sizeof(m_data));
+	m_journal.save(&m_data, sizeof(m_data));
+}
+
+void DoorStats::m_record(MoveStats& stats, unsigned int steps, unsigned long duration, bool timeout)
+{
+	if (stats.count == 0 || steps < stats.minSteps)
+		stats.minSteps = steps;
+	if (steps > stats.maxSteps)
+		stats.maxSteps = steps;
+
+	// Stop counting rather than wrap around, so the mean stays right
+	if (stats.count < 0xFFFF)
+	{
+		stats.count++;
+		stats.totalSteps += steps;
+	}
+	if (timeout)
+		stats.timeouts++;
+
+	stats.lastSteps = steps;
+	stats.lastDuration = duration;
+}
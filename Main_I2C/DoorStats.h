@@ -0,0 +1,52 @@
+#ifndef DOORSTATS_H
+#define DOORSTATS_H
+
+#include <arduino.h>
+#include "Journal.h"
+
+// Opening is flagged as drift when its step count is further than this from the calibrated value
+#define DRIFT_MIN_TOLERANCE 10	// in steps
+#define DRIFT_TOLERANCE_DIV 20	// or 1/20th (5%) of the calibrated value, whichever is larger
+
+// Running statistics for one direction of travel
+struct MoveStats
+{
+	uint16_t count;
+	uint16_t timeouts;			// moves that hit MAX_STEPS
+	uint16_t minSteps;
+	uint16_t maxSteps;
+	uint32_t totalSteps;		// mean = totalSteps / count
+	uint16_t lastSteps;
+	uint32_t lastDuration;		// in milliseconds
+} __attribute__((packed));
+
+struct DoorStatsData
+{
+	MoveStats open;
+	MoveStats close;
+	bool drift;
+} __attribute__((packed));
+
+// Travel telemetry for a door. Kept in its own journal, written once per move.
+class DoorStats
+{
+public:
+	DoorStats(int journal_addr);
+	void load();
+	void recordOpen(unsigned int steps, unsigned long duration, bool timeout, unsigned int calibrated_steps);
+	void recordClose(unsigned int steps, unsigned long duration, bool timeout);
+	void reset();	// after calibration
+
+	const MoveStats& getOpen() const {return m_data.open;}
+	const MoveStats& getClose() const {return m_data.close;}
+	unsigned int meanSteps(const MoveStats& stats) const {return stats.count ? stats.totalSteps / stats.count : 0;}
+	bool drifting() const {return m_data.drift;}
+
+private:
+	DoorStatsData m_data;
+	Journal m_journal;
+
+	void m_record(MoveStats& stats, unsigned int steps, unsigned long duration, bool timeout);
+};
+
+#endif // DOORSTATS_H
@@ -3,11 +3,46 @@
 
 #include <EEPROM.h>
 
-#define TIMEZONE_EEPROM_ADDR 0 			// byte
-#define OPEN_DELAY_EEPROM_ADDR 1		// byte
-#define CLOSE_DELAY_EEPROM_ADDR 2		// byte
-#define STEPS_TO_CLOSE_EEPROM_ADDR 3	// (unsigned) int
-#define DOOR_STATE_EEPROM_ADDR 5		// bool (one byte)
+// Fixed-address layout used by older firmware. Only read once, to import the settings into the journal.
+#define LEGACY_TIMEZONE_EEPROM_ADDR 0 			// byte
+#define LEGACY_OPEN_DELAY_EEPROM_ADDR 1			// byte
+#define LEGACY_CLOSE_DELAY_EEPROM_ADDR 2		// byte
+#define LEGACY_STEPS_TO_CLOSE_EEPROM_ADDR 3		// (unsigned) int
+#define LEGACY_DOOR_STATE_EEPROM_ADDR 5			// bool (one byte)
+
+// Settings journal (see Journal.h)
+#define SETTINGS_JOURNAL_ADDR 16
+#define SETTINGS_JOURNAL_SIZE 256		// 16 slots
+#define SETTINGS_SLOT_SIZE 16
+
+// Each door has its own statistics and position journals, DOOR_EEPROM_STRIDE bytes after those of the previous door.
+// There is room for MAX_DOORS doors before the trace. The addresses below are those of the first door.
+#define DOOR_EEPROM_STRIDE 240
+#define MAX_DOORS 2
+
+// Door travel statistics (see DoorStats.h)
+#define DOOR_STATS_JOURNAL_ADDR 272
+#define DOOR_STATS_JOURNAL_SIZE 120		// 3 slots
+#define DOOR_STATS_SLOT_SIZE 40
+
+// Door position checkpoints (see Door::m_checkpoint())
+#define DOOR_POSITION_JOURNAL_ADDR 392
+#define DOOR_POSITION_JOURNAL_SIZE 119	// 17 slots
+#define DOOR_POSITION_SLOT_SIZE 7
+
+// Last sunrise or sunset the doors followed (see Clock::recordTransition()), in the gap after the last door
+#define TRANSITION_JOURNAL_ADDR 752
+#define TRANSITION_JOURNAL_SIZE 16		// 2 slots
+#define TRANSITION_SLOT_SIZE 8
+
+// Board metrics (see Metrics.h)
+#define METRICS_JOURNAL_ADDR 768
+#define METRICS_JOURNAL_SIZE 60			// 2 slots
+#define METRICS_SLOT_SIZE 30
+
+// Event trace (see Trace.h), at the end of the EEPROM
+#define TRACE_EEPROM_ADDR 828
+#define TRACE_EEPROM_ENTRIES 39			// 5 bytes each
 
 
 #endif // EEPROM_ADDRESSES_H
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "EventHandler.h"
+#include "Trace.h"
 
 // --------------------------------------------------------------------- //
 // --					EVENT HANDLER IMPLEMENTATION				  -- //
@@ -16,18 +17,41 @@ void EventHandler::addListener(bool (*listenFunc)(), void (*callbackFunc)())
     m_listener_num++;
 }
 
+void EventHandler::addTask(bool (*taskFunc)())
+{
+    if (m_task_num == MAX_TASKS)
+        return;
+
+    m_tasks[m_task_num] = taskFunc;
+    m_task_num++;
+}
+
+void EventHandler::runTasks()
+{
+    m_busy = false;
+    for (byte i = 0; i < m_task_num; i++)
+    {
+        if (!m_tasks[i]())
+            m_busy = true;
+    }
+}
+
 void EventHandler::listen()
 {
     for (byte i = 0; i < m_listener_num; i++)
     {
         if (m_listeners_list[i].listenFunc())
+        {
             m_eventq.enqueue(m_listeners_list[i].event_code);
+            trace.record(TRACE_ENQUEUE, m_listeners_list[i].event_code);
+        }
     }
 }
 
 void EventHandler::enqueueEvent(byte event_code)
 {
     m_eventq.enqueue(event_code);
+    trace.record(TRACE_ENQUEUE, event_code);
 }
 
 void EventHandler::processEvent()
@@ -43,6 +67,7 @@ void EventHandler::processEvent()
     {
         if (m_listeners_list[i].event_code == event_code)
         {
+            trace.record(TRACE_PROCESS, event_code);
             m_listeners_list[i].callbackFunc();
             break;
         }
@@ -4,7 +4,8 @@
 #include <arduino.h>
 
 #define EVENT_QUEUE_SIZE 16
-#define MAX_LISTENERS 16
+#define MAX_LISTENERS 20	// what setup() adds with every feature of Profile.h built in
+#define MAX_TASKS 4
 
 #define signed_byte int8_t // equivalent to 'char' but more clear
 
@@ -37,12 +38,17 @@ private:
 class EventHandler
 {
 public:
-    EventHandler() : m_listeners_list(), m_listener_num(0) {}
+    EventHandler() : m_listeners_list(), m_listener_num(0), m_tasks(), m_task_num(0), m_busy(false) {}
     void enqueueEvent(byte event_code);
     void processEvent();		// Prcesses event in the front of the queue.
     void listen();				// Runs all the listeners and adds events to the queue if event happens (but does not process them).
     // listenFunc is a function that returns true if the event being listened to happens. callbackFunc is the function to be called when the event happens.
     void addListener(bool (*listenFunc)(), void (*callbackFunc)());
+    // taskFunc runs a long operation a little at a time (see Task.h). It is called by every runTasks() and returns true
+    // when it has nothing left to do, false while it is in the middle of something.
+    void addTask(bool (*taskFunc)());
+    void runTasks();
+    bool busy() const {return m_busy;}	// A task was in the middle of something at the last runTasks().
 
 private:
     struct Listener
@@ -55,6 +61,9 @@ private:
     };
     Listener m_listeners_list[MAX_LISTENERS];
     byte m_listener_num;
+    bool (*m_tasks[MAX_TASKS])();
+    byte m_task_num;
+    bool m_busy;
     EventQueue m_eventq;
 
 };
@@ -0,0 +1,99 @@
+#ifndef FASTPIN_H
+#define FASTPIN_H
+
+#include <arduino.h>
+
+// digitalRead() and digitalWrite() look the pin's port and bit up in flash tables on every call, and digitalWrite()
+// also checks for a PWM timer: about 50 cycles each. These two skip all that.
+//
+// FastPin<13>::high() is for pins known at compile time. On the ATmega328P the port and bit are constants, so each
+// access is a single SBI, CBI or SBIS instruction (which is also atomic, so interrupts need not be turned off).
+// Pin is for pins that are passed to a constructor: the lookup is done once, there, and each access is then a load
+// and a mask. On the host (the simulator) and on other boards both fall back to digitalRead() and digitalWrite().
+// Neither turns PWM off, so they are not for pins that analogWrite() has been used on.
+
+#if defined(__AVR_ATmega328P__)
+// Arduino pins 0-7 are PORTD, 8-13 PORTB and 14-19 (A0-A5) PORTC. PINx, DDRx and PORTx are consecutive I/O addresses.
+template <uint8_t PIN>
+struct FastPin
+{
+	static const uint8_t bit = (PIN < 8) ? PIN : (PIN < 14) ? PIN - 8 : PIN - 14;
+	static const uint8_t in = (PIN < 8) ? 0x09 : (PIN < 14) ? 0x03 : 0x06; // I/O address of PIND, PINB or PINC
+
+	static void output() {_SFR_IO8(in + 1) |= _BV(bit);}
+	static void input() {_SFR_IO8(in + 1) &= ~_BV(bit);}
+	static void high() {_SFR_IO8(in + 2) |= _BV(bit);}
+	static void low() {_SFR_IO8(in + 2) &= ~_BV(bit);}
+	static void write(bool value) {if (value) high(); else low();}
+	static bool read() {return _SFR_IO8(in) & _BV(bit);}
+};
+#else
+template <uint8_t PIN>
+struct FastPin
+{
+	static void output() {pinMode(PIN, OUTPUT);}
+	static void input() {pinMode(PIN, INPUT);}
+	static void high() {digitalWrite(PIN, HIGH);}
+	static void low() {digitalWrite(PIN, LOW);}
+	static void write(bool value) {digitalWrite(PIN, value);}
+	static bool read() {return digitalRead(PIN);}
+};
+#endif
+
+#if defined(__AVR__)
+class Pin
+{
+public:
+	Pin(uint8_t pin) : m_mask(digitalPinToBitMask(pin))
+	{
+		uint8_t port = digitalPinToPort(pin);
+		m_in = portInputRegister(port);
+		m_mode = portModeRegister(port);
+		m_out = portOutputRegister(port);
+	}
+
+	void output() {m_set(m_mode, true);}
+	void input() {m_set(m_mode, false);}
+	void high() {m_set(m_out, true);}
+	void low() {m_set(m_out, false);}
+	void write(bool value) {m_set(m_out, value);}
+	bool read() const {return *m_in & m_mask;}
+
+private:
+	volatile uint8_t* m_in;
+	volatile uint8_t* m_mode;
+	volatile uint8_t* m_out;
+	uint8_t m_mask;
+
+	// Read-modify-write through a pointer is not atomic: an interrupt that changes another pin of the port in between
+	// would be undone
+	void m_set(volatile uint8_t* reg, bool value)
+	{
+		uint8_t sreg = SREG;
+		cli();
+		if (value)
+			*reg |= m_mask;
+		else
+			*reg &= ~m_mask;
+		SREG = sreg;
+	}
+};
+#else
+class Pin
+{
+public:
+	Pin(uint8_t pin) : m_pin(pin) {}
+
+	void output() {pinMode(m_pin, OUTPUT);}
+	void input() {pinMode(m_pin, INPUT);}
+	void high() {digitalWrite(m_pin, HIGH);}
+	void low() {digitalWrite(m_pin, LOW);}
+	void write(bool value) {digitalWrite(m_pin, value);}
+	bool read() const {return digitalRead(m_pin);}
+
+private:
+	uint8_t m_pin;
+};
+#endif
+
+#endif // FASTPIN_H
@@ -0,0 +1,109 @@
+#include "I2CBus.h"
+#include <Wire.h>
+
+I2CBus i2c;
+
+// Also called by the first transaction, which can happen before setup() (from global constructors)
+void I2CBus::begin()
+{
+	if (m_begun)
+		return;
+
+	Wire.begin();
+	Wire.setClock(I2C_STANDARD_CLOCK);
+	Wire.setWireTimeout(I2C_TIMEOUT, true); // true: Wire resets the TWI hardware on a timeout
+	m_begun = true;
+}
+
+bool I2CBus::read(byte address, byte reg, byte* data, byte count, long clock)
+{
+	begin();
+	Wire.setClock(clock);
+	Wire.beginTransmission(address);
+	Wire.write(reg);
+	bool ok = (Wire.endTransmission(false) == 0); // repeated start, so nothing can get between the two
+	if (ok)
+		ok = (Wire.requestFrom(address, count) == count);
+	for (byte i = 0; ok && i < count; i++)
+		data[i] = Wire.read();
+	Wire.setClock(I2C_STANDARD_CLOCK);
+
+	if (!ok)
+		m_fail();
+	return ok;
+}
+
+bool I2CBus::write(byte address, byte reg, const byte* data, byte count, long clock)
+{
+	begin();
+	Wire.setClock(clock);
+	Wire.beginTransmission(address);
+	Wire.write(reg);
+	Wire.write(data, count);
+	bool ok = (Wire.endTransmission() == 0);
+	Wire.setClock(I2C_STANDARD_CLOCK);
+
+	if (!ok)
+		m_fail();
+	return ok;
+}
+
+bool I2CBus::check()
+{
+	if (!Wire.getWireTimeoutFlag())
+		return true;
+
+	m_fail();
+	return false;
+}
+
+void I2CBus::recover()
+{
+	m_errors.recoveries++;
+	Wire.end(); // gives SDA and SCL back to the port
+
+	// A slave that was cut off in the middle of a byte holds SDA low until it has been clocked to the end of it
+	m_pull(SDA, false);
+	m_pull(SCL, false);
+	delayMicroseconds(I2C_HALF_PERIOD);
+	for (byte i = 0; i < I2C_RECOVERY_PULSES && !digitalRead(SDA); i++)
+	{
+		m_pull(SCL, true);
+		delayMicroseconds(I2C_HALF_PERIOD);
+		m_pull(SCL, false);
+		delayMicroseconds(I2C_HALF_PERIOD);
+	}
+
+	// STOP: SDA rises while SCL is high
+	m_pull(SDA, true);
+	delayMicroseconds(I2C_HALF_PERIOD);
+	m_pull(SDA, false);
+	delayMicroseconds(I2C_HALF_PERIOD);
+
+	m_begun = false;
+	begin();
+}
+
+void I2CBus::m_fail()
+{
+	if (Wire.getWireTimeoutFlag())
+	{
+		Wire.clearWireTimeoutFlag();
+		m_errors.timeouts++;
+		recover();
+	}
+	else
+		m_errors.nacks++;
+}
+
+// The bus is open drain: a line is either pulled low or let go, and the pull-up raises it
+void I2CBus::m_pull(byte pin, bool low)
+{
+	if (low)
+	{
+		digitalWrite(pin, LOW);
+		pinMode(pin, OUTPUT);
+	}
+	else
+		pinMode(pin, INPUT_PULLUP);
+}
@@ -0,0 +1,45 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <arduino.h>
+
+#define I2C_STANDARD_CLOCK 100000L	// the PCF8574 on the LCD backpack is only rated for this
+#define I2C_FAST_CLOCK 400000L		// DS3231
+#define I2C_TIMEOUT 5000			// (microseconds) a transaction taking longer is abandoned and the bus recovered
+#define I2C_RECOVERY_PULSES 9		// enough clocks for a slave stuck in the middle of a byte to finish it
+#define I2C_HALF_PERIOD 5			// (microseconds) of the recovery clock, 100 kHz
+
+// Errors since boot
+struct I2CErrors
+{
+	unsigned int timeouts;		// the bus was stuck (a slave holding SDA or SCL low, or noise on the cable)
+	unsigned int nacks;			// a device did not answer
+	unsigned int recoveries;
+};
+
+// The Wire bus shared by the RTC and the LCD. It runs at I2C_STANDARD_CLOCK, because LiquidCrystal_I2C talks to Wire
+// directly, and read() and write() switch to a faster clock for the devices that allow it.
+// Every transaction gives up after I2C_TIMEOUT, so a glitch costs milliseconds instead of hanging loop().
+class I2CBus
+{
+public:
+	I2CBus() : m_begun(false), m_errors() {}
+	void begin();
+	// Register access. Return false if the transaction failed (the error is counted and the bus recovered if stuck).
+	bool read(byte address, byte reg, byte* data, byte count, long clock = I2C_STANDARD_CLOCK);
+	bool write(byte address, byte reg, const byte* data, byte count, long clock = I2C_STANDARD_CLOCK);
+	bool check();		// Same for the traffic that does not go through read() and write() (the LCD's). False if it timed out.
+	void recover();		// Clocks a stuck slave free, sends a STOP and restarts Wire.
+	const I2CErrors& errors() const {return m_errors;}
+
+private:
+	bool m_begun;
+	I2CErrors m_errors;
+
+	void m_fail();
+	void m_pull(byte pin, bool low);
+};
+
+extern I2CBus i2c;
+
+#endif // I2CBUS_H
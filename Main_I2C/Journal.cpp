@@ -0,0 +1,98 @@
+#include "Journal.h"
+#include <EEPROM.h>
+
+// CRC-8 with the Dallas/Maxim polynomial (x^8 + x^5 + x^4 + 1), one byte at a time
+byte crc8(byte crc, byte data)
+{
+	crc ^= data;
+	for (byte i = 0; i < 8; i++)
+		crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+
+	return crc;
+}
+
+Journal::Journal(int start_addr, int region_size, byte slot_size) : m_start(start_addr), m_slotSize(slot_size), m_slots(region_size / slot_size),
+m_newest(JOURNAL_NO_SLOT), m_seq(0), m_scanned(false)
+{}
+
+byte Journal::load(void* data, byte size)
+{
+	m_scan();
+	if (m_newest == JOURNAL_NO_SLOT)
+		return 0;
+
+	int addr = m_slotAddr(m_newest);
+	byte length = EEPROM.read(addr + 1);
+	byte* bytes = static_cast<byte*>(data);
+	for (byte i = 0; i < length && i < size; i++)
+		bytes[i] = EEPROM.read(addr + JOURNAL_HEADER_SIZE + i);
+
+	return length;
+}
+
+bool Journal::save(const void* data, byte size)
+{
+	if (size > maxDataSize())
+		return false;
+
+	if (!m_scanned)
+		m_scan();
+
+	byte slot = (m_newest == JOURNAL_NO_SLOT) ? 0 : (m_newest + 1) % m_slots;
+	byte seq = (m_newest == JOURNAL_NO_SLOT) ? 0 : m_seq + 1;
+	int addr = m_slotAddr(slot);
+	const byte* bytes = static_cast<const byte*>(data);
+
+	// The CRC is of what should be in the slot, not of what was read back: a write that went wrong then fails it
+	byte crc = crc8(crc8(0, seq), size);
+	EEPROM.update(addr, seq);
+	EEPROM.update(addr + 1, size);
+	for (byte i = 0; i < size; i++)
+	{
+		EEPROM.update(addr + JOURNAL_HEADER_SIZE + i, bytes[i]);
+		crc = crc8(crc, bytes[i]);
+	}
+	EEPROM.update(addr + JOURNAL_HEADER_SIZE + size, crc);
+
+	m_newest = slot;
+	m_seq = seq;
+	return true;
+}
+
+// Single pass over every slot. The newest record is the valid one with the highest sequence number,
+// compared as a signed difference so that the number can wrap around from 255 to 0.
+void Journal::m_scan()
+{
+	m_newest = JOURNAL_NO_SLOT;
+	for (byte slot = 0; slot < m_slots; slot++)
+	{
+		int addr = m_slotAddr(slot);
+		byte seq = EEPROM.read(addr);
+		byte length = EEPROM.read(addr + 1);
+
+		// Erased EEPROM reads 0xFF, which is never a valid length
+		if (length == 0 || length > maxDataSize())
+			continue;
+
+		if (EEPROM.read(addr + JOURNAL_HEADER_SIZE + length) != m_slotCRC(slot, length))
+			continue;
+
+		if (m_newest == JOURNAL_NO_SLOT || (signed_byte)(seq - m_seq) > 0)
+		{
+			m_newest = slot;
+			m_seq = seq;
+		}
+	}
+	m_scanned = true;
+}
+
+// Of the slot as it is in EEPROM, to check it against the CRC stored with it
+byte Journal::m_slotCRC(byte slot, byte length) const
+{
+	int addr = m_slotAddr(slot);
+	byte crc = 0;
+	for (byte i = 0; i < JOURNAL_HEADER_SIZE + length; i++)
+		crc = crc8(crc, EEPROM.read(addr + i));
+
+	return crc;
+}
@@ -0,0 +1,40 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <arduino.h>
+
+#define signed_byte int8_t // equivalent to 'char' but more clear
+
+#define JOURNAL_HEADER_SIZE 2 // sequence number + data length
+#define JOURNAL_NO_SLOT 0xFF
+#define JOURNAL_MAX_DATA(slot_size) ((slot_size) - JOURNAL_HEADER_SIZE - 1) // header and CRC take the rest of the slot
+
+// A Journal spreads writes of one record over a region of EEPROM. Every save goes to the slot after the newest one,
+// so each cell is written once every (region size / slot size) saves instead of every time.
+// Slot layout: [sequence number][data length][data ...][CRC-8 of everything before it]
+// A slot that was only partially written (power loss) fails its CRC, and the previous record is still there.
+class Journal
+{
+public:
+	Journal(int start_addr, int region_size, byte slot_size);
+	byte load(void* data, byte size);			// Copies the newest valid record into data. Returns its stored length (0 if there is none).
+	bool save(const void* data, byte size);	// Returns false, and writes nothing, if the record does not fit in a slot
+	byte maxDataSize() const {return JOURNAL_MAX_DATA(m_slotSize);}
+
+private:
+	const int m_start;
+	const byte m_slotSize;
+	const byte m_slots;		// must be less than 128 for the sequence number comparison to work
+	byte m_newest;			// slot of the newest valid record (JOURNAL_NO_SLOT if none)
+	byte m_seq;				// sequence number of the newest valid record
+	bool m_scanned;
+
+	void m_scan();
+
+	int m_slotAddr(byte slot) const {return m_start + slot*m_slotSize;}
+	byte m_slotCRC(byte slot, byte length) const;
+};
+
+byte crc8(byte crc, byte data);
+
+#endif // JOURNAL_H
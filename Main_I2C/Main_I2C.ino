@@ -3,33 +3,54 @@
 // Junio 2020
 // Última actualización: 14 de Agosto 2020
 
-#include <Stepper.h>
+#include "Profile.h"
+#include "StepperDriver.h"
 #include <LiquidCrystal_I2C.h>
 #include <EEPROM.h>
 #include "EventHandler.h"
 #include "Classes.h"
+#include "Settings.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include "Strings.h"
 #include "FreeMemory.h"
-#include "EEPROM_ADDRESSES.h"
+#include "StackMonitor.h"
+#include "Protocol.h"
+#include "I2CBus.h"
+#include "Task.h"
+
+// Doors. Each one has its own motor driver (L298N), limit switch and calibration. The EEPROM has room for MAX_DOORS.
+#define DOOR_COUNT 1
+#if DOOR_COUNT > MAX_DOORS
+#error "Not enough EEPROM for that many doors (see EEPROM_ADDRESSES.h)"
+#endif
 
 // Motor
 #define STEPS_PER_REV 200
 #define MOTOR_SPEED 60 // in rpm
-#define STEPS_TO_CLOSE_DOOR 200
 #define IN1 11
 #define IN2 10
 #define IN3 9
 #define IN4 8
+#define DOOR2_IN1 6
+#define DOOR2_IN2 12
+#define DOOR2_IN3 A0
+#define DOOR2_IN4 A1
 
 // Limit switch reads HIGH when not activated (door not open)
 #define LIMIT_SWITCH 7
+#define DOOR2_LIMIT_SWITCH A2
 #define DOOR_CHECK_INTERVAL 1800000 // (30 minutes) How often we check to see if door is really open (i.e. limit switch is activated)
 
 // Buttons
 #define RIGHT_BUTTON 4
 #define LEFT_BUTTON 5
-//#define UP_BUTTON 4
-//#define DOWN_BUTTON 3
+#define UP_BUTTON 2 // FEATURE_UP_DOWN_BUTTONS only (see Profile.h)
+#define DOWN_BUTTON 3
+#if FEATURE_DISPLAY && FEATURE_UP_DOWN_BUTTONS && \
+	(UP_BUTTON == RIGHT_BUTTON || UP_BUTTON == LEFT_BUTTON || DOWN_BUTTON == RIGHT_BUTTON || DOWN_BUTTON == LEFT_BUTTON)
+#error "The up and down buttons need pins of their own when the display's buttons are built in"
+#endif
 #define DEBOUNCE_TIME 50 // minimum time a button has to be pressed for it to register as a click (in milliseconds)
 #define LONG_CLICK_TIME 600 // minimum time to hold for a long click
 #define DOUBLE_CLICK_SEPARATION 300 // maximum separation between two clicks for a double click
@@ -37,6 +58,9 @@
 // LCD
 #define DISPLAY_TIMEOUT_TIME 120000 // Time after which display will turn off if inactive
 
+// Memory
+#define MEMORY_CHECK_INTERVAL 10000 // How often the stack headroom is checked (in milliseconds)
+
 // Listeners
 bool dayListener();
 bool nightListener();
@@ -52,8 +76,13 @@ bool displayTimeoutListener();
 bool doorCheckListener(); // returns true if door says open but limit switch is not activated
 bool displayUpdateListener();
 bool displayChanged = false;
-//bool upClickListener();
-//bool downClickListener();
+bool settingsCommitListener();
+bool traceFlushListener();
+bool serialListener();
+bool lowMemoryListener();
+bool upClickListener();
+bool downClickListener();
+bool metricsFlushListener();
 
 // Callback functions
 void onDay();
@@ -69,26 +98,91 @@ void onLimitSwitch();
 void onDisplayTimeout();
 void onDoorCheck();
 void onDisplayUpdate();
-//void onUpClick();
-//void onDownClick();
+void onSettingsCommit();
+void onTraceFlush();
+void onSerial();
+void onLowMemory();
+void onUpClick();
+void onDownClick();
+void onMetricsFlush();
+
+// Tasks
+bool doorTask();
+bool displayTask();
 
 
-Stepper motor(STEPS_PER_REV, IN1, IN2, IN3, IN4);
+StepperDriver motors[DOOR_COUNT] =
+{
+	StepperDriver(STEPS_PER_REV, StepperPins<IN1, IN2, IN3, IN4>()),
+#if DOOR_COUNT > 1
+	StepperDriver(STEPS_PER_REV, StepperPins<DOOR2_IN1, DOOR2_IN2, DOOR2_IN3, DOOR2_IN4>()),
+#endif
+};
+#if FEATURE_DISPLAY
 LiquidCrystal_I2C lcd(0x27, 16, 2);
+#define DOOR_LCD &lcd
+#else
+#define DOOR_LCD NULL
+#endif
 Clock myclock;
+Settings settings;
 
-Door door(LIMIT_SWITCH, STEPS_TO_CLOSE_DOOR, &motor, &lcd);
-
+Door doorList[DOOR_COUNT] =
+{
+	Door(0, LIMIT_SWITCH, DEFAULT_STEPS_TO_CLOSE, &motors[0], DOOR_LCD, &settings),
+#if DOOR_COUNT > 1
+	Door(1, DOOR2_LIMIT_SWITCH, DEFAULT_STEPS_TO_CLOSE, &motors[1], DOOR_LCD, &settings),
+#endif
+};
+DoorGroup doors(doorList, DOOR_COUNT);
+
+#if FEATURE_DISPLAY
 Button rightButton(RIGHT_BUTTON);
 Button leftButton(LEFT_BUTTON);
-//Button upButton(UP_BUTTON);
-//Button downButton(DOWN_BUTTON);
 
-Display display(&lcd, &door, &myclock, &rightButton, &leftButton);
+Display display(&lcd, &doors, &myclock, &settings, &rightButton, &leftButton);
+#endif
+
+#if FEATURE_UP_DOWN_BUTTONS
+Button upButton(UP_BUTTON);
+Button downButton(DOWN_BUTTON);
+#endif
+
+#if FEATURE_SERIAL
+Protocol protocol(&Serial, &settings, &myclock, &doors);
+#endif
 
 EventHandler eventHdl;
 
-bool serial = true;
+const bool serial = FEATURE_SERIAL; // a constant, so that the compiler drops the Serial code when it is off
+
+// Boot phases (see Trace.h), in microseconds since reset
+#define BOOT_PHASES 4
+unsigned long bootTimes[BOOT_PHASES];
+
+void bootPhase(byte phase)
+{
+	bootTimes[phase - 1] = micros();
+	trace.record(TRACE_BOOT_PHASE, phase);
+}
+
+// A sunrise or sunset may have gone by while the board was off. If so, the doors are sent to wherever the clock says
+// they should be before anything else is set up. If not, they stay where they were left, even if that was by hand.
+void bootDecision()
+{
+	bool day = myclock.isDay();
+	myclock.resetListeners(day);
+	if (!myclock.transitionMissed())
+		return;
+
+	if (serial)
+		Serial.println(F("Catching up on a missed sunrise or sunset."));
+	myclock.recordTransition();
+	if (day)
+		doors.startOpen();
+	else
+		doors.startClose();
+}
 
 void setup()
 {
@@ -100,31 +194,62 @@ void setup()
 		Serial.println(freeMemory()); // for some reason this needs to be here for the program to work on the off-brand UNO
 	}
 
-	// Read data from EEPROM
-	myclock.setTimezone(EEPROM.read(TIMEZONE_EEPROM_ADDR));
-	myclock.setOpenDelay(EEPROM.read(OPEN_DELAY_EEPROM_ADDR));
-	myclock.setCloseDelay(EEPROM.read(CLOSE_DELAY_EEPROM_ADDR));
+	// Read data from EEPROM (falls back to defaults if there is no valid record)
+	if (!settings.load() && serial)
+		Serial.println(F("No saved settings, using defaults."));
+
+	myclock.setTimezone(settings.getTimezone());
+	myclock.setOpenDelay(settings.getOpenDelay());
+	myclock.setCloseDelay(settings.getCloseDelay());
+	// Opening and closing times besides sunrise and sunset (see Schedule.h), e.g. to keep the hens in during the
+	// hottest hours of the day and let them out by 8 am on weekends whatever the time of sunrise:
+	// myclock.addRule(RULE_TIME, 13*60, false);
+	// myclock.addRule(RULE_TIME, 16*60, true);
+	// myclock.addRule(RULE_TIME, 8*60, true, WEEKENDS);
+	for (byte i = 0; i < DOOR_COUNT; i++)
+	{
+		Door* door = doors.get(i);
+		door->setStepsToClose(settings.getStepsToClose(i));
+		door->setStepModes(settings.getOpenStepMode(), settings.getCloseStepMode());
+		// Only the first door existed before the position journal
+		if (!door->restore())
+			door->setDoorState(i == 0 && settings.getDoorOpen());
+		door->loadStats();
+		motors[i].setSpeed(MOTOR_SPEED);
+	}
+
+	trace.begin(&myclock);
+	metrics.begin();
+
+	// Finish a door move that a reset interrupted
+	for (byte i = 0; i < DOOR_COUNT; i++)
+	{
+		if (doors.get(i)->interrupted())
+		{
+			if (serial)
+				Serial.println(F("Recovering interrupted door move."));
+			doors.get(i)->recover();
+		}
+	}
+	bootPhase(TRACE_BOOT_STATE);
 
-	unsigned int stepsToClose;
-	EEPROM.get(STEPS_TO_CLOSE_EEPROM_ADDR, stepsToClose);
-	door.setStepsToClose(stepsToClose);
-	door.setDoorState(EEPROM.read(DOOR_STATE_EEPROM_ADDR));
+	// The doors step from doorTask(), so this only starts them
+	bootDecision();
+	bootPhase(TRACE_BOOT_DECISION);
 
-	// Initialize display
+#if FEATURE_DISPLAY
+	// Initialize display. Nothing above needs it, and the LCD has to be given time to power up.
 	lcd.init();
 	lcd.backlight();
 	lcd.clear();
-	printMessage(&lcd, WELCOME_MSG);
-	lcd.setCursor(0, 1);
-	lcd.print(F("  Ardugallino   "));
-	delay(1500);
-	
-	// Set motor speed
-	motor.setSpeed(MOTOR_SPEED);
+	display.splash();
+	bootPhase(TRACE_BOOT_DISPLAY);
+#endif
 
 	// Add listeners.
 	eventHdl.addListener(&dayListener, &onDay); // 0
 	eventHdl.addListener(&nightListener, &onNight); // 1
+#if FEATURE_DISPLAY
 	eventHdl.addListener(&clickListener, &onClick); // 2 this has to be added before the other click listeners
 	eventHdl.addListener(&rightClickListener, &onRightClick); // 3
 	eventHdl.addListener(&leftClickListener, &onLeftClick); // 4
@@ -132,22 +257,51 @@ void setup()
 	eventHdl.addListener(&leftDoubleClickListener, &onLeftDoubleClick); // 6
 	eventHdl.addListener(&rightLongClickListener, &onRightLongClick); // 7
 	eventHdl.addListener(&leftLongClickListener, &onLeftLongClick); // 8
+#endif
 	eventHdl.addListener(&limitSwitchListener, &onLimitSwitch); // 9
+#if FEATURE_DISPLAY
 	eventHdl.addListener(&displayTimeoutListener, &onDisplayTimeout); // 10
-	//eventHdl.addListener(&doorCheckListener, &onDoorCheck); // 11
+#endif
+#if FEATURE_DOOR_CHECK
+	eventHdl.addListener(&doorCheckListener, &onDoorCheck); // 11
+#endif
+#if FEATURE_DISPLAY
 	eventHdl.addListener(&displayUpdateListener, &onDisplayUpdate); // 12
-	//eventHdl.addListener(&upClickListener, &onUpClick); // 13
-	//eventHdl.addListener(&downClickListener, &onDownClick); // 14
+#endif
+	eventHdl.addListener(&settingsCommitListener, &onSettingsCommit); // 13
+	eventHdl.addListener(&traceFlushListener, &onTraceFlush); // 14
+#if FEATURE_SERIAL
+	eventHdl.addListener(&serialListener, &onSerial); // 15
+#endif
+	eventHdl.addListener(&lowMemoryListener, &onLowMemory); // 16
+#if FEATURE_UP_DOWN_BUTTONS
+	eventHdl.addListener(&upClickListener, &onUpClick); // 17
+	eventHdl.addListener(&downClickListener, &onDownClick); // 18
+#endif
+	eventHdl.addListener(&metricsFlushListener, &onMetricsFlush); // 19
+
+	// Add tasks.
+	eventHdl.addTask(&doorTask);
+#if FEATURE_DISPLAY
+	eventHdl.addTask(&displayTask);
+#endif
+	bootPhase(TRACE_BOOT_READY);
 
 	if (serial)
 	{
 		Serial.println(F("Setup complete."));
+		Serial.print(F("Boot phases (us):"));
+		for (byte i = 0; i < BOOT_PHASES; i++)
+		{
+			Serial.print(' ');
+			Serial.print(bootTimes[i]);
+		}
+		Serial.println();
 		Serial.print(F("Free memory: "));
 		Serial.println(freeMemory());
+		Serial.print(F("Stack headroom: "));
+		Serial.println(stackHeadroom());
 	}
-
-	display.rightClick();
-	display.refresh();
 }
 
 unsigned long lastRefresh = millis();
@@ -155,7 +309,9 @@ void loop()
 {
 	eventHdl.listen();
 	eventHdl.processEvent();
-	if (serial)
+	eventHdl.runTasks();
+	i2c.check(); // recovers the bus if the LCD's traffic timed out
+	if (FEATURE_DEBUG_LOG)
 	{
 		Serial.print(F("Free memory: "));
 		Serial.println(freeMemory());
@@ -172,74 +328,74 @@ bool nightListener()
 	return myclock.sunsetListener();;
 }
 
+#if FEATURE_DISPLAY
 bool clickArray[] = {false, false, false, false, false, false}; // {left click, left double click, left long click, right click, right double click, right long click}
-bool clickListener() // always returns false
+Task clickTask;
+byte clickShift;
+unsigned long clickStart;
+unsigned long clickDuration;
+
+bool clickButtonPressed()
 {
-	// Determine if we are working with a right or left click, or neither (in that case, do nothing and return false)
-	byte shift;
+	return (clickShift == 0) ? leftButton.isPressed() : rightButton.isPressed();
+}
+
+// Tells clicks, double clicks and long clicks apart. It is a task (see Task.h) that gives loop() back while it waits,
+// so holding a button no longer stops the doors and the clock. It finishes once the button has been let go.
+bool detectClick()
+{
+	TASK_BEGIN(clickTask);
+
+	// Determine if we are working with a right or left click, or neither (in that case, do nothing)
 	if (rightButton.isPressed())
-		shift = 3;
+		clickShift = 3;
 	else if (leftButton.isPressed())
-		shift = 0;
+		clickShift = 0;
 	else
-		return false;
+		TASK_EXIT(clickTask);
 
 	// Measure how long the button was pressed (for a maximum of timeout)
-	unsigned long initial_time = millis();
-	if (shift == 0)
-	{
-		while (leftButton.isPressed() && (millis() - initial_time < LONG_CLICK_TIME))
-		{}
-	}
-	else
-	{
-		while (rightButton.isPressed() && (millis() - initial_time < LONG_CLICK_TIME))
-		{}
-	}
-	unsigned long click_duration = millis() - initial_time;
+	clickStart = millis();
+	TASK_WAIT_UNTIL(clickTask, !clickButtonPressed() || millis() - clickStart >= LONG_CLICK_TIME);
+	clickDuration = millis() - clickStart;
 
-	if (click_duration < DEBOUNCE_TIME) // no click detected
-		return false;
+	if (clickDuration < DEBOUNCE_TIME) // no click detected
+		TASK_EXIT(clickTask);
 
-	if (click_duration >= LONG_CLICK_TIME) // long click detected
+	if (clickDuration >= LONG_CLICK_TIME) // long click detected
 	{
-		clickArray[2 + shift] = true;
-		return false;
+		clickArray[2 + clickShift] = true;
+		TASK_WAIT_UNTIL(clickTask, !clickButtonPressed());
+		TASK_EXIT(clickTask);
 	}
 
 	// If not long click, wait to see if there is a double click
-	while (millis() - (initial_time + click_duration) < DOUBLE_CLICK_SEPARATION)
+	clickStart += clickDuration; // when the button was let go
+	while (millis() - clickStart < DOUBLE_CLICK_SEPARATION)
 	{
-		click_duration = 0; // repurpose click_duration
 		// If button is pressed again, check if it stays pressed for the debounce time
-		if (shift == 0 && leftButton.isPressed())
+		if (clickButtonPressed())
 		{
-			// repurpose initial_time and click_duration
-			initial_time = millis();
-			while (leftButton.isPressed() && (millis() - initial_time < DEBOUNCE_TIME))
-			{}
-			click_duration = millis() - initial_time;
+			clickDuration = millis(); // repurposed: start of the second press
+			TASK_WAIT_UNTIL(clickTask, !clickButtonPressed() || millis() - clickDuration >= DEBOUNCE_TIME);
+			if (millis() - clickDuration >= DEBOUNCE_TIME) // double click detected
+			{
+				clickArray[1 + clickShift] = true;
+				TASK_WAIT_UNTIL(clickTask, !clickButtonPressed());
+				TASK_EXIT(clickTask);
+			}
 		}
-		else if (shift == 3 && rightButton.isPressed())
-		{
-			// repurpose initial_time and click_duration
-			initial_time = millis();
-			while (rightButton.isPressed() && (millis() - initial_time < DEBOUNCE_TIME))
-			{}
-			click_duration = millis() - initial_time;
-		}
-
-		if (click_duration >= DEBOUNCE_TIME) // double click detected
-		{
-			clickArray[1 + shift] = true;
-			return false;
-		}
-
+		TASK_YIELD(clickTask);
 	}
 
 	// If not double click, it was a normal click
-	clickArray[0 + shift] = true;
+	clickArray[0 + clickShift] = true;
+	TASK_END(clickTask);
+}
 
+bool clickListener() // always returns false
+{
+	detectClick();
 	return false;
 }
 
@@ -302,12 +458,14 @@ bool rightLongClickListener()
 	}
 	return false;
 }
+#endif
 
 bool limitSwitchListener()
 {
 	return false;
 }
 
+#if FEATURE_DISPLAY
 bool displayTimeoutListener()
 {
 	if (display.isOn())
@@ -315,6 +473,7 @@ bool displayTimeoutListener()
 
 	return false;
 }
+#endif
 
 unsigned long lastCheckedDoor = millis();
 bool doorCheckListener()
@@ -322,11 +481,16 @@ bool doorCheckListener()
 	if (millis() - lastCheckedDoor > DOOR_CHECK_INTERVAL)
 	{
 		lastCheckedDoor = millis();
-		return (door.isOpen() && !digitalRead(LIMIT_SWITCH));
+		for (byte i = 0; i < DOOR_COUNT; i++)
+		{
+			if (doors.get(i)->isOpen() && !doors.get(i)->switchPressed())
+				return true;
+		}
 	}
 	return false;
 }
 
+#if FEATURE_DISPLAY
 byte lastMinute = myclock.getMin();
 float lastTemp = myclock.getTemp();
 bool displayUpdateListener()
@@ -343,43 +507,92 @@ bool displayUpdateListener()
 	}
 	return displayChanged;
 }
+#endif
+
+bool settingsCommitListener()
+{
+	return settings.commitDue();
+}
+
+bool traceFlushListener()
+{
+	return trace.flushDue();
+}
+
+bool metricsFlushListener()
+{
+	return metrics.flushDue();
+}
 
-/*
+#if FEATURE_SERIAL
+bool serialListener()
+{
+	return serial && protocol.poll();
+}
+#endif
+
+// Fires once, the first time the headroom drops below SRAM_WARNING_THRESHOLD (with the stack painted, it can only
+// go down; without, a check only sees the stack as deep as it is at that moment)
+unsigned long lastMemoryCheck = millis();
+bool lowMemoryWarned = false;
+bool lowMemoryListener()
+{
+	if (lowMemoryWarned || millis() - lastMemoryCheck < MEMORY_CHECK_INTERVAL)
+		return false;
+
+	lastMemoryCheck = millis();
+	lowMemoryWarned = (stackHeadroom() < SRAM_WARNING_THRESHOLD);
+	return lowMemoryWarned;
+}
+
+#if FEATURE_UP_DOWN_BUTTONS
+// A press counts once it has lasted DEBOUNCE_TIME, and only once until the button is let go. Nothing waits for the
+// release: the doors move from doorTask().
+bool buttonPressed(const Button& button, unsigned long& start, bool& fired)
+{
+	if (!button.isPressed())
+	{
+		start = millis();
+		fired = false;
+		return false;
+	}
+	if (fired || millis() - start < DEBOUNCE_TIME)
+		return false;
+
+	fired = true;
+	return true;
+}
+
+unsigned long upPressStart;
+bool upPressFired = false;
 bool upClickListener()
 {
-	unsigned long initial_time = millis();
-	while (upButton.isPressed() && (millis() - initial_time < LONG_CLICK_TIME)) // use long click time as maximum wait time
-	{}
-	
-	unsigned long click_duration = millis() - initial_time;
-	return (click_duration >= DEBOUNCE_TIME);
+	return buttonPressed(upButton, upPressStart, upPressFired);
 }
 
+unsigned long downPressStart;
+bool downPressFired = false;
 bool downClickListener()
 {
-	unsigned long initial_time = millis();
-	while (downButton.isPressed() && (millis() - initial_time < LONG_CLICK_TIME)) // use long click time as maximum wait time
-	{}
-	
-	unsigned long click_duration = millis() - initial_time;
-	return (click_duration >= DEBOUNCE_TIME);
+	return buttonPressed(downButton, downPressStart, downPressFired);
 }
-*/
+#endif
 
 void onDay()
 {
 	//Serial.println(F("Day!"));
-	door.open();
-	display.refresh();
+	myclock.recordTransition();
+	doors.startOpen();
 }
 
 void onNight()
 {
 	//Serial.println(F("Night!"));
-	door.close();
-	display.refresh();
+	myclock.recordTransition();
+	doors.startClose();
 }
 
+#if FEATURE_DISPLAY
 void onRightClick()
 {
 	displayChanged = true;
@@ -399,10 +612,6 @@ void onRightDoubleClick()
 	displayChanged = true;
 	//Serial.println(F("Right double click!"));
 	display.rightDoubleClick();
-	// wait until button is lifted to continue
-	while (rightButton.isPressed())
-	{
-	}
 }
 
 void onLeftDoubleClick()
@@ -410,10 +619,6 @@ void onLeftDoubleClick()
 	displayChanged = true;
 	//Serial.println(F("Left double click!"));
 	display.leftDoubleClick();
-	// wait until button is lifted to continue
-	while (leftButton.isPressed())
-	{
-	}
 }
 
 void onRightLongClick()
@@ -421,10 +626,6 @@ void onRightLongClick()
 	displayChanged = true;
 	//Serial.println(F("Right long click!"));
 	display.rightLongClick();
-	// wait until button is lifted to continue
-	while (rightButton.isPressed())
-	{
-	}
 }
 
 void onLeftLongClick()
@@ -432,51 +633,161 @@ void onLeftLongClick()
 	displayChanged = true;
 	//Serial.println(F("Left long click!"));
 	display.leftLongClick();
-	// wait until button is lifted to continue
-	while (leftButton.isPressed())
-	{
-	}
 }
+#endif
 
 void onLimitSwitch()
 {
 }
 
+#if FEATURE_DISPLAY
 void onDisplayTimeout()
 {
 	displayChanged = true;
 	display.turnOff();
 }
+#endif
 
 void onDoorCheck()
 {
-	door.open(true);
+	doors.startOpen(true);
 	displayChanged = true;
 }
 
+#if FEATURE_DISPLAY
 void onDisplayUpdate()
 {
 	display.refresh();
 	displayChanged = false;
 }
+#endif
+
+void onSettingsCommit()
+{
+	settings.commit();
+}
 
-/*
+void onTraceFlush()
+{
+	trace.flush();
+}
+
+void onMetricsFlush()
+{
+	metrics.flush();
+}
+
+#if FEATURE_SERIAL
+// Binary commands are run by the protocol (see Protocol.h and GallineroCli.py).
+// Of the text commands, 'T' dumps the event trace (decode it with TraceDecoder.py), 'M' prints memory usage and I2C errors
+// and 'S' the board metrics (see Metrics.h).
+void onSerial()
+{
+	char c = protocol.handle();
+	displayChanged = true; // a command may have moved a door or changed the settings
+	if (c == 'T' || c == 't')
+		trace.dump(&Serial);
+	else if (c == 'M' || c == 'm')
+	{
+		Serial.print(F("Free memory: "));
+		Serial.println(freeMemory());
+		Serial.print(F("Stack headroom: "));
+		Serial.println(stackHeadroom());
+#if EXPERIMENTAL_STACK_PAINT
+		Serial.print(F("Stack high water: "));
+		Serial.println(stackHighWater());
+#endif
+		Serial.print(F("I2C timeouts/nacks/recoveries: "));
+		Serial.print(i2c.errors().timeouts);
+		Serial.print('/');
+		Serial.print(i2c.errors().nacks);
+		Serial.print('/');
+		Serial.println(i2c.errors().recoveries);
+	}
+	else if (c == 'S' || c == 's')
+	{
+		const MetricsData& data = metrics.get();
+		Serial.print(F("Opens/closes/timeouts: "));
+		Serial.print(data.opens);
+		Serial.print('/');
+		Serial.print(data.closes);
+		Serial.print('/');
+		Serial.println(data.timeouts);
+		Serial.print(F("Motor time (s): "));
+		Serial.println(data.motorMillis / 1000);
+		Serial.print(F("I2C errors: "));
+		Serial.println(data.i2cErrors);
+		Serial.print(F("Resets power-on/external/brown-out/watchdog/unknown: "));
+		for (byte i = 0; i < RESET_CAUSES; i++)
+		{
+			if (i > 0)
+				Serial.print('/');
+			Serial.print(data.resets[i]);
+		}
+		Serial.println();
+		Serial.print(F("MCUSR at boot: 0x"));
+		Serial.println(data.lastReset, HEX);
+		Serial.print(F("Uptime (s): "));
+		Serial.print(millis() / 1000);
+		Serial.print(F(" this boot, "));
+		Serial.print(data.uptime);
+		Serial.println(F(" in all"));
+	}
+}
+#endif
+
+void onLowMemory()
+{
+	unsigned int headroom = stackHeadroom();
+	trace.record(TRACE_LOW_MEMORY, headroom);
+	trace.flush();
+	if (serial)
+	{
+		Serial.print(F("Low memory! Stack headroom: "));
+		Serial.println(headroom);
+	}
+}
+
+#if FEATURE_UP_DOWN_BUTTONS
 void onUpClick()
 {
 	displayChanged = true;
-	door.open();
-	// wait until button is lifted
-	while (upButton.isPressed())
-	{}
+	doors.startOpen();
 }
 
 void onDownClick()
 {
 	displayChanged = true;
-	door.close();
-	// wait until button is lifted
-	while (downButton.isPressed())
-	{}
+	doors.startClose();
+}
+#endif
+
+// Moves the doors a slice at a time, and redraws the screen once they have stopped
+bool doorTask()
+{
+	if (!doors.moving())
+		return true;
+	if (!doors.run())
+		return false;
+
+	displayChanged = true;
+	metrics.flush(); // a few times a day, so the counts of the move are not left to the daily flush
+	if (serial && !doors.anyOpen())
+	{
+		for (byte i = 0; i < DOOR_COUNT; i++)
+		{
+			Serial.print(F("Door "));
+			Serial.print(i + 1);
+			Serial.print(F(" open/close cycle energy (mJ): "));
+			Serial.println(doors.get(i)->getCycleEnergy());
+		}
+	}
+	return true;
 }
-*/
 
+#if FEATURE_DISPLAY
+bool displayTask()
+{
+	return display.run();
+}
+#endif
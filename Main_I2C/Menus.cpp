@@ -0,0 +1,58 @@
+#include "Menus.h"
+#include "Strings.h"
+
+// One row per menu, one column per gesture: {next menu, action}.
+// Adding a menu costs a row here and a screen below, instead of a case in every click handler.
+const MenuTransition menuTable[MENU_COUNT][GESTURE_COUNT] PROGMEM =
+{
+	//					Right click								Left click								Right double click						Left double click						Right long click							Left long click
+	/* OFF */			{{DOOR_STATUS, WAKE_UP},				{DOOR_STATUS, WAKE_UP},					{DOOR_STATUS, WAKE_UP},					{DOOR_STATUS, WAKE_UP},					{OFF, NO_ACTION},							{OFF, NO_ACTION}},
+	/* DOOR_STATUS */	{{TEMP_AND_DATE, NO_ACTION},			{METRICS, NO_ACTION},				{OPEN_DELAY_MODIFY, NO_ACTION},			{OFF, NO_ACTION},						{DOOR_STATUS, NO_ACTION},					{DOOR_STATUS, NO_ACTION}},
+	/* TEMP_AND_DATE */	{{METRICS, NO_ACTION},					{DOOR_STATUS, NO_ACTION},				{TEMP_AND_DATE, NO_ACTION},				{OFF, NO_ACTION},						{TEMP_AND_DATE, NO_ACTION},					{TEMP_AND_DATE, NO_ACTION}},
+	/* DOOR_MODIFY */	{{DOOR_MANUAL_MODIFY, NO_ACTION},		{DOOR_SELECT, NO_ACTION},				{DOOR_MODIFY, NO_ACTION},				{DOOR_STATUS, NO_ACTION},				{DOOR_MODIFY, TOGGLE_DOOR},					{DOOR_MODIFY, NO_ACTION}},
+	/* DOOR_MANUAL_MODIFY */{{DOOR_CALIBRATE, NO_ACTION},		{DOOR_MODIFY, NO_ACTION},				{DOOR_MANUAL_MODIFY, NO_ACTION},		{DOOR_STATUS, NO_ACTION},				{DOOR_MANUAL_MODIFY, MANUAL_OPEN},			{DOOR_MANUAL_MODIFY, MANUAL_CLOSE}},
+	/* DOOR_CALIBRATE */{{OPEN_DELAY_MODIFY, NO_ACTION},		{DOOR_MANUAL_MODIFY, NO_ACTION},		{DOOR_CALIBRATE, NO_ACTION},			{DOOR_STATUS, NO_ACTION},				{CALIBRATION_WAIT, START_CALIBRATION},		{DOOR_CALIBRATE, NO_ACTION}},
+	/* OPEN_DELAY_MODIFY */{{CLOSE_DELAY_MODIFY, NO_ACTION},	{DOOR_CALIBRATE, NO_ACTION},			{OPEN_DELAY_MODIFY, NO_ACTION},			{DOOR_STATUS, NO_ACTION},				{OPEN_DELAY_COUNTER, NO_ACTION},			{OPEN_DELAY_MODIFY, NO_ACTION}},
+	/* CLOSE_DELAY_MODIFY */{{TIMEZONE_MODIFY, NO_ACTION},		{OPEN_DELAY_MODIFY, NO_ACTION},			{CLOSE_DELAY_MODIFY, NO_ACTION},		{DOOR_STATUS, NO_ACTION},				{CLOSE_DELAY_COUNTER, NO_ACTION},			{CLOSE_DELAY_MODIFY, NO_ACTION}},
+	/* CALIBRATION_WAIT */{{CALIBRATION_WAIT, NO_ACTION},		{CALIBRATION_WAIT, NO_ACTION},			{CALIBRATION_WAIT, NO_ACTION},			{DOOR_CALIBRATE, CANCEL_CALIBRATION},	{DOOR_STATUS, CALIBRATE},					{CALIBRATION_WAIT, MANUAL_CLOSE}},
+	/* OPEN_DELAY_COUNTER */{{OPEN_DELAY_COUNTER, OPEN_DELAY_UP},{OPEN_DELAY_COUNTER, OPEN_DELAY_DOWN},	{OPEN_DELAY_COUNTER, NO_ACTION},		{OPEN_DELAY_MODIFY, NO_ACTION},			{OPEN_DELAY_MODIFY, SAVE_OPEN_DELAY},		{OPEN_DELAY_COUNTER, NO_ACTION}},
+	/* CLOSE_DELAY_COUNTER */{{CLOSE_DELAY_COUNTER, CLOSE_DELAY_UP},{CLOSE_DELAY_COUNTER, CLOSE_DELAY_DOWN},{CLOSE_DELAY_COUNTER, NO_ACTION},	{CLOSE_DELAY_MODIFY, NO_ACTION},		{CLOSE_DELAY_MODIFY, SAVE_CLOSE_DELAY},		{CLOSE_DELAY_COUNTER, NO_ACTION}},
+	/* TIMEZONE_MODIFY */{{TIME_MODIFY, NO_ACTION},				{CLOSE_DELAY_MODIFY, NO_ACTION},		{TIMEZONE_MODIFY, NO_ACTION},			{DOOR_STATUS, NO_ACTION},				{TIMEZONE_COUNTER, NO_ACTION},				{TIMEZONE_MODIFY, NO_ACTION}},
+	/* TIMEZONE_COUNTER */{{TIMEZONE_COUNTER, TIMEZONE_UP},		{TIMEZONE_COUNTER, TIMEZONE_DOWN},		{TIMEZONE_COUNTER, NO_ACTION},			{TIMEZONE_MODIFY, NO_ACTION},			{TIMEZONE_MODIFY, SAVE_TIMEZONE},			{TIMEZONE_COUNTER, NO_ACTION}},
+	/* TIME_MODIFY */	{{DATE_MODIFY, NO_ACTION},				{TIMEZONE_MODIFY, NO_ACTION},			{TIME_MODIFY, NO_ACTION},				{DOOR_STATUS, NO_ACTION},				{HOURS_COUNTER, NO_ACTION},					{TIME_MODIFY, NO_ACTION}},
+	/* DATE_MODIFY */	{{DOOR_SELECT, NO_ACTION},				{TIME_MODIFY, NO_ACTION},				{DATE_MODIFY, NO_ACTION},				{DOOR_STATUS, NO_ACTION},				{YEAR_COUNTER, NO_ACTION},					{DATE_MODIFY, NO_ACTION}},
+	/* HOURS_COUNTER */	{{HOURS_COUNTER, HOUR_UP},				{HOURS_COUNTER, HOUR_DOWN},				{HOURS_COUNTER, NO_ACTION},				{TIME_MODIFY, NO_ACTION},				{MINUTES_COUNTER, NO_ACTION},				{HOURS_COUNTER, NO_ACTION}},
+	/* MINUTES_COUNTER */{{MINUTES_COUNTER, MINUTE_UP},			{MINUTES_COUNTER, MINUTE_DOWN},			{MINUTES_COUNTER, NO_ACTION},			{HOURS_COUNTER, NO_ACTION},				{TIME_MODIFY, NO_ACTION},					{MINUTES_COUNTER, NO_ACTION}},
+	/* YEAR_COUNTER */	{{YEAR_COUNTER, YEAR_UP},				{YEAR_COUNTER, YEAR_DOWN},				{YEAR_COUNTER, NO_ACTION},				{DATE_MODIFY, NO_ACTION},				{MONTH_COUNTER, NO_ACTION},					{YEAR_COUNTER, NO_ACTION}},
+	/* MONTH_COUNTER */	{{MONTH_COUNTER, MONTH_UP},				{MONTH_COUNTER, MONTH_DOWN},			{MONTH_COUNTER, NO_ACTION},				{YEAR_COUNTER, NO_ACTION},				{DAY_COUNTER, NO_ACTION},					{MONTH_COUNTER, NO_ACTION}},
+	/* DAY_COUNTER */	{{DAY_COUNTER, DAY_UP},					{DAY_COUNTER, DAY_DOWN},				{DAY_COUNTER, NO_ACTION},				{MONTH_COUNTER, NO_ACTION},				{DATE_MODIFY, NO_ACTION},					{DAY_COUNTER, NO_ACTION}},
+	/* DOOR_SELECT */	{{DOOR_MODIFY, NO_ACTION},				{DATE_MODIFY, NO_ACTION},				{DOOR_SELECT, NO_ACTION},				{DOOR_STATUS, NO_ACTION},				{DOOR_SELECT, SELECT_DOOR},					{DOOR_SELECT, NO_ACTION}},
+	/* METRICS */		{{DOOR_STATUS, NO_ACTION},				{TEMP_AND_DATE, NO_ACTION},				{METRICS, NO_ACTION},					{OFF, NO_ACTION},						{METRICS, NO_ACTION},						{METRICS, NO_ACTION}}
+};
+
+// One screen per menu: {layout, line 0 message, line 1 message, value}
+const MenuScreen menuScreens[MENU_COUNT] PROGMEM =
+{
+	/* OFF */					{SCREEN_OFF, 0, 0, NO_VALUE},
+	/* DOOR_STATUS */			{SCREEN_DOOR_STATUS, 0, 0, NO_VALUE},
+	/* TEMP_AND_DATE */			{SCREEN_TEMP_AND_DATE, 0, 0, NO_VALUE},
+	/* DOOR_MODIFY */			{SCREEN_DOOR_MODIFY, HOLD_R_MSG, 0, NO_VALUE},
+	/* DOOR_MANUAL_MODIFY */	{SCREEN_TEXT, MANUAL_MODIFY_MSG, MANUAL_MODIFY2_MSG, NO_VALUE},
+	/* DOOR_CALIBRATE */		{SCREEN_TEXT, HOLD_R_MSG, CALIBRATE_DOOR_MSG, NO_VALUE},
+	/* OPEN_DELAY_MODIFY */		{SCREEN_SETTING, HOLD_R_CHANGE_MSG, OPEN_DELAY_LABEL_MSG, OPEN_DELAY_VALUE},
+	/* CLOSE_DELAY_MODIFY */	{SCREEN_SETTING, HOLD_R_CHANGE_MSG, CLOSE_DELAY_LABEL_MSG, CLOSE_DELAY_VALUE},
+	/* CALIBRATION_WAIT */		{SCREEN_TEXT, CLOSE_DOOR_HOLD_MSG, R_TO_CONTINUE_MSG, NO_VALUE},
+	/* OPEN_DELAY_COUNTER */	{SCREEN_DELAY_COUNTER, 0, HOLD_R_SAVE_MSG, OPEN_DELAY_VALUE},
+	/* CLOSE_DELAY_COUNTER */	{SCREEN_DELAY_COUNTER, 0, HOLD_R_SAVE_MSG, CLOSE_DELAY_VALUE},
+	/* TIMEZONE_MODIFY */		{SCREEN_SETTING, HOLD_R_CHANGE_MSG, TIMEZONE_LABEL_MSG, TIMEZONE_VALUE},
+	/* TIMEZONE_COUNTER */		{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, TIMEZONE_VALUE},
+	/* TIME_MODIFY */			{SCREEN_SETTING, HOLD_R_CHANGE_MSG, TIME_LABEL_MSG, TIME_VALUE},
+	/* DATE_MODIFY */			{SCREEN_SETTING, HOLD_R_CHANGE_MSG, DATE_LABEL_MSG, DATE_VALUE},
+	/* HOURS_COUNTER */			{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, HOUR_VALUE},
+	/* MINUTES_COUNTER */		{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, MINUTE_VALUE},
+	/* YEAR_COUNTER */			{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, YEAR_VALUE},
+	/* MONTH_COUNTER */			{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, MONTH_VALUE},
+	/* DAY_COUNTER */			{SCREEN_COUNTER, 0, HOLD_R_SAVE_MSG, DAY_VALUE},
+	/* DOOR_SELECT */			{SCREEN_SETTING, HOLD_R_CHANGE_MSG, DOOR_LABEL_MSG, DOOR_VALUE},
+	/* METRICS */				{SCREEN_METRICS, 0, 0, NO_VALUE}
+};
@@ -0,0 +1,53 @@
+#ifndef MENUS_H
+#define MENUS_H
+
+#include <arduino.h>
+
+// Button gestures, in the order of the columns of menuTable
+enum Gesture {RIGHT_CLICK, LEFT_CLICK, RIGHT_DOUBLE_CLICK, LEFT_DOUBLE_CLICK, RIGHT_LONG_CLICK, LEFT_LONG_CLICK, GESTURE_COUNT};
+
+// Menu states, in the order of the rows of menuTable and menuScreens
+enum Menu {OFF, DOOR_STATUS, TEMP_AND_DATE, DOOR_MODIFY, DOOR_MANUAL_MODIFY, DOOR_CALIBRATE, OPEN_DELAY_MODIFY, CLOSE_DELAY_MODIFY, CALIBRATION_WAIT,
+	OPEN_DELAY_COUNTER, CLOSE_DELAY_COUNTER, TIMEZONE_MODIFY, TIMEZONE_COUNTER, TIME_MODIFY, DATE_MODIFY, HOURS_COUNTER, MINUTES_COUNTER,
+	YEAR_COUNTER, MONTH_COUNTER, DAY_COUNTER, DOOR_SELECT, METRICS, MENU_COUNT};
+
+// What a gesture does besides changing menu (see Display::m_doAction())
+enum MenuAction {NO_ACTION, WAKE_UP, TOGGLE_DOOR, START_CALIBRATION, CANCEL_CALIBRATION, CALIBRATE, MANUAL_OPEN, MANUAL_CLOSE,
+	OPEN_DELAY_UP, OPEN_DELAY_DOWN, SAVE_OPEN_DELAY, CLOSE_DELAY_UP, CLOSE_DELAY_DOWN, SAVE_CLOSE_DELAY, TIMEZONE_UP, TIMEZONE_DOWN, SAVE_TIMEZONE,
+	HOUR_UP, HOUR_DOWN, MINUTE_UP, MINUTE_DOWN, YEAR_UP, YEAR_DOWN, MONTH_UP, MONTH_DOWN, DAY_UP, DAY_DOWN, SELECT_DOOR};
+
+// How a menu is drawn (see Display::m_display())
+enum ScreenLayout {
+	SCREEN_OFF,
+	SCREEN_DOOR_STATUS,
+	SCREEN_TEMP_AND_DATE,
+	SCREEN_DOOR_MODIFY,
+	SCREEN_TEXT,			// line0 message, line1 message
+	SCREEN_SETTING,			// "Hold R to change", line1 message followed by the value and ")"
+	SCREEN_COUNTER,			// "< value >", "Hold R to save"
+	SCREEN_DELAY_COUNTER,	// "< value >" and the resulting open/close time, "Hold R to save"
+	SCREEN_METRICS			// opens/closes, resets, errors and days of uptime (see Metrics.h)
+};
+
+// Values shown by SCREEN_SETTING and the counters
+enum MenuValue {NO_VALUE, OPEN_DELAY_VALUE, CLOSE_DELAY_VALUE, TIMEZONE_VALUE, TIME_VALUE, DATE_VALUE, HOUR_VALUE, MINUTE_VALUE,
+	YEAR_VALUE, MONTH_VALUE, DAY_VALUE, DOOR_VALUE};
+
+struct MenuTransition
+{
+	byte next;		// Menu
+	byte action;	// MenuAction
+};
+
+struct MenuScreen
+{
+	byte layout;	// ScreenLayout
+	byte line0;		// message numbers from Strings.h
+	byte line1;
+	byte value;		// MenuValue
+};
+
+extern const MenuTransition menuTable[MENU_COUNT][GESTURE_COUNT] PROGMEM;
+extern const MenuScreen menuScreens[MENU_COUNT] PROGMEM;
+
+#endif // MENUS_H
@@ -0,0 +1,108 @@
+#include "Metrics.h"
+#include "I2CBus.h"
+#include "EEPROM_ADDRESSES.h"
+
+Metrics metrics;
+
+static_assert(sizeof(MetricsData) <= JOURNAL_MAX_DATA(METRICS_SLOT_SIZE), "MetricsData does not fit a metrics journal slot");
+
+#if defined(__AVR__)
+// MCUSR keeps its flags until they are cleared, so they are cleared once read, or the next reset would show this one's
+// flags too. Nothing before begin() (the core's init() or the global constructors) touches MCUSR or the watchdog.
+static byte readResetFlags()
+{
+	byte flags = MCUSR;
+	MCUSR = 0;
+	return flags;
+}
+
+static byte resetCause(byte resetFlags)
+{
+	if (resetFlags & _BV(PORF))
+		return RESET_POWER_ON;
+	if (resetFlags & _BV(BORF))
+		return RESET_BROWN_OUT;
+	if (resetFlags & _BV(WDRF))
+		return RESET_WATCHDOG;
+	if (resetFlags & _BV(EXTRF))
+		return RESET_EXTERNAL;
+	return RESET_UNKNOWN;
+}
+#else
+static byte readResetFlags()
+{
+	return 0x01; // PORF
+}
+
+static byte resetCause(byte resetFlags)
+{
+	return RESET_POWER_ON;
+}
+#endif
+
+Metrics::Metrics() : m_journal(METRICS_JOURNAL_ADDR, METRICS_JOURNAL_SIZE, METRICS_SLOT_SIZE), m_i2cBefore(0),
+m_lastFlush(0), m_uptimeMark(0)
+{
+	memset(&m_data, 0, sizeof(m_data));
+}
+
+void Metrics::begin()
+{
+	if (m_journal.load(&m_data, sizeof(m_data)) != sizeof(m_data))
+		memset(&m_data, 0, sizeof(m_data));
+
+	m_i2cBefore = m_data.i2cErrors;
+	byte flags = readResetFlags();
+	m_data.resets[resetCause(flags)]++;
+	m_data.lastReset = flags;
+	flush();
+}
+
+void Metrics::recordOpen(unsigned long duration, bool timeout)
+{
+	m_data.opens++;
+	if (timeout)
+		m_data.timeouts++;
+	recordMotor(duration);
+}
+
+void Metrics::recordClose(unsigned long duration)
+{
+	m_data.closes++;
+	recordMotor(duration);
+}
+
+void Metrics::recordMotor(unsigned long duration)
+{
+	m_data.motorMillis += duration;
+}
+
+void Metrics::flush()
+{
+	m_update();
+	m_journal.save(&m_data, sizeof(m_data));
+	m_lastFlush = millis();
+}
+
+const MetricsData& Metrics::get()
+{
+	m_update();
+	return m_data;
+}
+
+unsigned int Metrics::resets() const
+{
+	unsigned int total = 0;
+	for (byte i = 0; i < RESET_CAUSES; i++)
+		total += m_data.resets[i];
+	return total;
+}
+
+// Brings the uptime and the I2C errors up to now. Whole seconds only: the rest is counted next time.
+void Metrics::m_update()
+{
+	unsigned long seconds = (millis() - m_uptimeMark) / 1000;
+	m_uptimeMark += seconds * 1000;
+	m_data.uptime += seconds;
+	m_data.i2cErrors = m_i2cBefore + i2c.errors().timeouts + i2c.errors().nacks;
+}
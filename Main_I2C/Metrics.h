@@ -0,0 +1,57 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <arduino.h>
+#include "Journal.h"
+
+#define METRICS_FLUSH_INTERVAL 86400000UL	// (1 day) How often the counters are written to EEPROM, besides after door moves
+
+// Causes of a reset, from MCUSR
+#define RESET_POWER_ON 0
+#define RESET_EXTERNAL 1	// the reset button, or the Serial port being opened
+#define RESET_BROWN_OUT 2
+#define RESET_WATCHDOG 3
+#define RESET_UNKNOWN 4		// the bootloader cleared MCUSR
+#define RESET_CAUSES 5
+
+struct MetricsData
+{
+	uint16_t opens;
+	uint16_t closes;
+	uint16_t timeouts;				// openings that hit MAX_STEPS
+	uint32_t motorMillis;			// time the motors were on, holding included
+	uint16_t i2cErrors;				// timeouts and NACKs
+	uint16_t resets[RESET_CAUSES];
+	byte lastReset;					// MCUSR at the last boot
+	uint32_t uptime;				// in seconds, over all boots
+} __attribute__((packed));
+
+// Counters of the whole board since its EEPROM was blank. They are kept in SRAM and written to their own journal once a
+// day and after door moves, so the EEPROM sees a few writes a day. A boot is written at once: a reset that comes
+// before the next write (a brown-out as the motor starts, say) is counted all the same.
+class Metrics
+{
+public:
+	Metrics();
+	void begin();		// Loads the counters and counts the reset that started this boot
+	void recordOpen(unsigned long duration, bool timeout);
+	void recordClose(unsigned long duration);
+	void recordMotor(unsigned long duration);	// motor time of moves that are neither, like calibrations
+	void flush();
+	bool flushDue() const {return millis() - m_lastFlush >= METRICS_FLUSH_INTERVAL;}
+	const MetricsData& get();		// Counters up to now, including what has not been written yet
+	unsigned int resets() const;	// of all causes
+
+private:
+	MetricsData m_data;
+	Journal m_journal;
+	unsigned int m_i2cBefore;		// I2C errors of the boots before this one
+	unsigned long m_lastFlush;
+	unsigned long m_uptimeMark;		// millis() up to which the uptime has been counted
+
+	void m_update();
+};
+
+extern Metrics metrics;
+
+#endif // METRICS_H
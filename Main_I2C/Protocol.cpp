@@ -0,0 +1,349 @@
+#include "Protocol.h"
+#include "Classes.h"
+#include "Settings.h"
+#include "Journal.h"
+#include "StackMonitor.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+static void put16(byte* p, unsigned int value)
+{
+	p[0] = value & 0xFF;
+	p[1] = value >> 8;
+}
+
+static unsigned int get16(const byte* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+Protocol::Protocol(Stream* s, Settings* settings, Clock* cl, DoorGroup* doors) : m_stream(s), m_settings(settings), m_clock(cl), m_doors(doors),
+m_length(0), m_inFrame(false), m_escaped(false), m_overflow(false), m_ready(false), m_text(0)
+{}
+
+// Decodes SLIP one byte at a time, so a frame can arrive over several passes of the event loop
+bool Protocol::poll()
+{
+	if (m_ready)
+		return false;
+
+	while (m_stream->available())
+	{
+		byte b = m_stream->read();
+
+		if (!m_inFrame)
+		{
+			if (b == SLIP_END)
+			{
+				m_inFrame = true;
+				m_length = 0;
+				m_escaped = false;
+				m_overflow = false;
+			}
+			else if (b != '\r' && b != '\n')
+			{
+				m_text = b;
+				m_ready = true;
+				return true;
+			}
+			continue;
+		}
+
+		if (b == SLIP_END)
+		{
+			if (m_length == 0) // back to back ENDs
+				continue;
+
+			m_inFrame = false;
+			m_text = 0;
+			m_ready = true;
+			return true;
+		}
+
+		if (b == SLIP_ESC)
+		{
+			m_escaped = true;
+			continue;
+		}
+
+		if (m_escaped)
+		{
+			if (b == SLIP_ESC_END)
+				b = SLIP_END;
+			else if (b == SLIP_ESC_ESC)
+				b = SLIP_ESC;
+			m_escaped = false;
+		}
+
+		if (m_length < PROTOCOL_MAX_FRAME)
+			m_frame[m_length++] = b;
+		else
+			m_overflow = true;
+	}
+	return false;
+}
+
+char Protocol::handle()
+{
+	if (!m_ready)
+		return 0;
+	m_ready = false;
+
+	if (m_text)
+		return m_text;
+
+	byte command = m_frame[0];
+	byte length = m_length;
+	m_length = 0;
+
+	if (m_overflow || length < 2)
+	{
+		m_send(command, STATUS_BAD_LENGTH);
+		return 0;
+	}
+
+	byte crc = 0;
+	for (byte i = 0; i < length - 1; i++)
+		crc = crc8(crc, m_frame[i]);
+
+	if (crc != m_frame[length - 1])
+	{
+		m_send(command, STATUS_BAD_CRC);
+		return 0;
+	}
+
+	m_send(command, m_run(command, length - 2));
+	return 0;
+}
+
+byte Protocol::m_run(byte command, byte length)
+{
+	switch (command)
+	{
+		case CMD_GET_STATUS:
+			return m_getStatus();
+
+		case CMD_GET_SETTINGS:
+			return m_getSettings();
+
+		case CMD_SET_SETTINGS:
+			return m_setSettings(length);
+
+		case CMD_SET_TIME:
+			return m_setTime(length);
+
+		case CMD_DOOR:
+			return m_door(length);
+
+		case CMD_GET_STATS:
+			return m_getStats(length);
+
+		case CMD_GET_METRICS:
+			return m_getMetrics(length);
+
+		default:
+			return STATUS_UNKNOWN_COMMAND;
+	}
+}
+
+byte Protocol::m_getStatus()
+{
+	byte* out = m_frame + 2;
+	out[0] = m_clock->getHour();
+	out[1] = m_clock->getMin();
+	out[2] = m_clock->getDay();
+	out[3] = m_clock->getMonth();
+	put16(out + 4, m_clock->getYear());
+	put16(out + 6, (int)(m_clock->getTemp() * 100));
+	put16(out + 8, stackHeadroom());
+	out[10] = m_doors->count();
+	m_length = 11;
+
+	for (byte i = 0; i < m_doors->count(); i++)
+	{
+		Door* door = m_doors->get(i);
+		out[m_length] = (door->isOpen() ? 0x01 : 0) | (door->getStats().drifting() ? 0x02 : 0);
+		put16(out + m_length + 1, door->getPosition());
+		put16(out + m_length + 3, door->getStepsToClose());
+		m_length += 5;
+	}
+	return STATUS_OK;
+}
+
+byte Protocol::m_getSettings()
+{
+	byte* out = m_frame + 2;
+	out[0] = m_settings->getTimezone();
+	out[1] = m_settings->getOpenDelay();
+	out[2] = m_settings->getCloseDelay();
+	out[3] = m_settings->getOpenStepMode();
+	out[4] = m_settings->getCloseStepMode();
+	m_length = 5;
+
+	for (byte i = 0; i < m_doors->count(); i++)
+	{
+		put16(out + m_length, m_settings->getStepsToClose(i));
+		m_length += 2;
+	}
+	return STATUS_OK;
+}
+
+// Everything is checked before anything is changed, so a bad message leaves the settings as they were
+byte Protocol::m_setSettings(byte length)
+{
+	const byte* in = m_frame + 1;
+	if (length != 5 + 2*m_doors->count())
+		return STATUS_BAD_LENGTH;
+
+	signed_byte timezone = in[0];
+	if (timezone < MIN_TIMEZONE || timezone > MAX_TIMEZONE || in[3] > HALF_STEP || in[4] > HALF_STEP)
+		return STATUS_BAD_ARGUMENT;
+
+	for (byte i = 0; i < m_doors->count(); i++)
+	{
+		unsigned int steps = get16(in + 5 + 2*i);
+		if (steps < 1 || steps > MAX_STEPS)
+			return STATUS_BAD_ARGUMENT;
+	}
+
+	m_settings->setTimezone(timezone);
+	m_settings->setOpenDelay(in[1]);
+	m_settings->setCloseDelay(in[2]);
+	m_settings->setStepModes(in[3], in[4]);
+	m_clock->setTimezone(timezone);
+	m_clock->setOpenDelay(in[1]);
+	m_clock->setCloseDelay(in[2]);
+
+	for (byte i = 0; i < m_doors->count(); i++)
+	{
+		unsigned int steps = get16(in + 5 + 2*i);
+		m_settings->setStepsToClose(i, steps);
+		m_doors->get(i)->setStepsToClose(steps);
+		m_doors->get(i)->setStepModes(in[3], in[4]);
+	}
+
+	m_settings->commit();
+	return STATUS_OK;
+}
+
+// One RTC write for the whole date and time, instead of one per click in the counter menus
+byte Protocol::m_setTime(byte length)
+{
+	const byte* in = m_frame + 1;
+	if (length != 7)
+		return STATUS_BAD_LENGTH;
+
+	int year = get16(in);
+	byte month = in[2];
+	byte day = in[3];
+	if (year < 2000 || year > 2099 || month < 1 || month > 12 || day < 1 || day > 31 || in[4] > 23 || in[5] > 59 || in[6] > 59)
+		return STATUS_BAD_ARGUMENT;
+
+	if (!m_clock->setDateTime(year, month, day, in[4], in[5], in[6])) // a day past the end of its month
+		return STATUS_BAD_ARGUMENT;
+	trace.recordTime();
+	return STATUS_OK;
+}
+
+// Starts the move and answers at once. The move goes on in loop(), like the ones started by the menus.
+byte Protocol::m_door(byte length)
+{
+	const byte* in = m_frame + 1;
+	if (length != 2)
+		return STATUS_BAD_LENGTH;
+
+	byte action = in[0];
+	byte number = in[1];
+	bool all = (number == PROTOCOL_ALL_DOORS);
+	if (!all && number >= m_doors->count())
+		return STATUS_BAD_ARGUMENT;
+
+	switch (action)
+	{
+		case PROTOCOL_DOOR_OPEN:
+			if (all)
+				m_doors->startOpen();
+			else
+				m_doors->get(number)->startOpen();
+			return STATUS_OK;
+
+		case PROTOCOL_DOOR_CLOSE:
+			if (all)
+				m_doors->startClose();
+			else
+				m_doors->get(number)->startClose();
+			return STATUS_OK;
+
+		case PROTOCOL_DOOR_CALIBRATE: // the door has to be closed by hand first
+			if (all)
+				return STATUS_BAD_ARGUMENT;
+			m_doors->get(number)->startCalibrate();
+			return STATUS_OK;
+
+		default:
+			return STATUS_BAD_ARGUMENT;
+	}
+}
+
+byte Protocol::m_getStats(byte length)
+{
+	if (length != 1)
+		return STATUS_BAD_LENGTH;
+
+	byte number = m_frame[1];
+	if (number >= m_doors->count())
+		return STATUS_BAD_ARGUMENT;
+
+	const DoorStats& stats = m_doors->get(number)->getStats();
+	byte* out = m_frame + 2;
+	memcpy(out, &stats.getOpen(), sizeof(MoveStats));
+	memcpy(out + sizeof(MoveStats), &stats.getClose(), sizeof(MoveStats));
+	out[2*sizeof(MoveStats)] = stats.drifting();
+	m_length = 2*sizeof(MoveStats) + 1;
+	return STATUS_OK;
+}
+
+byte Protocol::m_getMetrics(byte length)
+{
+	if (length != 0)
+		return STATUS_BAD_LENGTH;
+
+	memcpy(m_frame + 2, &metrics.get(), sizeof(MetricsData));
+	m_length = sizeof(MetricsData);
+	return STATUS_OK;
+}
+
+// Sends [command | PROTOCOL_REPLY][status][m_length bytes from m_frame + 2][CRC-8]
+void Protocol::m_send(byte command, byte status)
+{
+	command |= PROTOCOL_REPLY;
+	byte crc = crc8(crc8(0, command), status);
+
+	m_stream->write(SLIP_END);
+	m_sendByte(command);
+	m_sendByte(status);
+	for (byte i = 0; i < m_length; i++)
+	{
+		crc = crc8(crc, m_frame[2 + i]);
+		m_sendByte(m_frame[2 + i]);
+	}
+	m_sendByte(crc);
+	m_stream->write(SLIP_END);
+	m_length = 0;
+}
+
+void Protocol::m_sendByte(byte b)
+{
+	if (b == SLIP_END)
+	{
+		m_stream->write(SLIP_ESC);
+		m_stream->write(SLIP_ESC_END);
+	}
+	else if (b == SLIP_ESC)
+	{
+		m_stream->write(SLIP_ESC);
+		m_stream->write(SLIP_ESC_ESC);
+	}
+	else
+		m_stream->write(b);
+}
@@ -0,0 +1,80 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <arduino.h>
+
+// Binary commands over Serial, for configuring and auditing the coop from a computer (see GallineroCli.py).
+// Each frame is SLIP-encoded: END [command][data ...][CRC-8 of command and data] END
+// Replies have the same layout, with the command's top bit set and a status byte before the data.
+// Multi-byte values are little endian.
+// Single characters outside a frame are still read as the old text commands ('T' trace dump, 'M' memory).
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+#define PROTOCOL_MAX_FRAME 48	// command + data + CRC, before encoding
+#define PROTOCOL_REPLY 0x80
+
+// Commands
+#define CMD_GET_STATUS 0x01		// reply: hour, minute, day, month, year (2), temperature in 1/100 C (2), stack headroom (2), door count,
+								//        then for each door: flags (bit 0 open, bit 1 drift), position (2), steps to close (2)
+#define CMD_GET_SETTINGS 0x02	// reply: timezone, open delay, close delay, open step mode, close step mode, then steps to close (2) per door
+#define CMD_SET_SETTINGS 0x03	// data: same as the GET_SETTINGS reply. Applied and written to EEPROM at once.
+#define CMD_SET_TIME 0x04		// data: year (2), month, day, hour, minute, second
+#define CMD_DOOR 0x05			// data: PROTOCOL_DOOR_OPEN/CLOSE/CALIBRATE, door number (PROTOCOL_ALL_DOORS for open/close of every door).
+								// Answered as soon as the move has started.
+#define CMD_GET_STATS 0x06		// data: door number. reply: DoorStatsData (see DoorStats.h)
+#define CMD_GET_METRICS 0x07	// reply: MetricsData (see Metrics.h), up to now
+
+#define PROTOCOL_DOOR_OPEN 1
+#define PROTOCOL_DOOR_CLOSE 2
+#define PROTOCOL_DOOR_CALIBRATE 3
+#define PROTOCOL_ALL_DOORS 0xFF
+
+// Reply status
+#define STATUS_OK 0
+#define STATUS_BAD_CRC 1
+#define STATUS_UNKNOWN_COMMAND 2
+#define STATUS_BAD_LENGTH 3
+#define STATUS_BAD_ARGUMENT 4
+
+class Stream;
+class Settings;
+class Clock;
+class DoorGroup;
+
+class Protocol
+{
+public:
+	Protocol(Stream* s, Settings* settings, Clock* cl, DoorGroup* doors);
+	bool poll();		// Reads what has arrived so far, without waiting. Returns true once a frame or text command is complete.
+	char handle();		// Runs the command that poll() completed and sends the reply. Text commands are returned instead (0 for frames).
+
+private:
+	Stream* m_stream;
+	Settings* m_settings;
+	Clock* m_clock;
+	DoorGroup* m_doors;
+
+	byte m_frame[PROTOCOL_MAX_FRAME];	// the received frame, then the reply
+	byte m_length;
+	bool m_inFrame;
+	bool m_escaped;
+	bool m_overflow;
+	bool m_ready;						// a frame or text command is waiting for handle()
+	char m_text;						// the text command (0 for a frame)
+
+	byte m_run(byte command, byte length);	// Returns the reply status. The reply data is written to m_frame + 2 and m_length.
+	byte m_getStatus();
+	byte m_getSettings();
+	byte m_setSettings(byte length);
+	byte m_setTime(byte length);
+	byte m_door(byte length);
+	byte m_getStats(byte length);
+	byte m_getMetrics(byte length);
+	void m_send(byte command, byte status);
+	void m_sendByte(byte b);
+};
+
+#endif // PROTOCOL_H
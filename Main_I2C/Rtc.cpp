@@ -0,0 +1,91 @@
+#include "Rtc.h"
+#include "I2CBus.h"
+
+static byte fromBcd(byte value)
+{
+	return (value >> 4) * 10 + (value & 0x0F);
+}
+
+static byte toBcd(byte value)
+{
+	return ((value / 10) << 4) | (value % 10);
+}
+
+// The DS3231 only counts years 2000 to 2099 here, so every fourth one is a leap year
+static byte daysInMonth(byte month, uint16_t year)
+{
+	if (month == 2)
+		return (year % 4 == 0) ? 29 : 28;
+	return (month == 4 || month == 6 || month == 9 || month == 11) ? 30 : 31;
+}
+
+// Until the first reading works
+Rtc::Rtc() : m_temp(0)
+{
+	m_time.hour = 0;
+	m_time.min = 0;
+	m_time.sec = 0;
+	m_time.date = 1;
+	m_time.mon = 1;
+	m_time.year = 2000;
+	m_time.dow = 6;
+}
+
+Time Rtc::getTime()
+{
+	byte regs[7];
+	if (!i2c.read(DS3231_ADDRESS, DS3231_TIME_REGISTER, regs, sizeof(regs), I2C_FAST_CLOCK))
+		return m_time;
+
+	m_time.sec = fromBcd(regs[0] & 0x7F);
+	m_time.min = fromBcd(regs[1]);
+	m_time.hour = fromBcd(regs[2] & 0x3F); // always set in 24 hour mode
+	m_time.dow = regs[3];
+	m_time.date = fromBcd(regs[4]);
+	m_time.mon = fromBcd(regs[5] & 0x1F);
+	m_time.year = 2000 + fromBcd(regs[6]) + ((regs[5] & 0x80) ? 100 : 0); // century bit
+	return m_time;
+}
+
+// Out of range values are refused: the DS3231 would keep them, and count on from there
+bool Rtc::setTime(byte hour, byte minute, byte second)
+{
+	if (hour > 23 || minute > 59 || second > 59)
+		return false;
+
+	byte regs[3] = {toBcd(second), toBcd(minute), toBcd(hour)};
+	return i2c.write(DS3231_ADDRESS, DS3231_TIME_REGISTER, regs, sizeof(regs), I2C_FAST_CLOCK);
+}
+
+bool Rtc::setDate(byte day, byte month, uint16_t year)
+{
+	if (month < 1 || month > 12 || year < 2000 || year > 2099 || day < 1 || day > daysInMonth(month, year))
+		return false;
+
+	byte regs[3] = {toBcd(day), toBcd(month), toBcd(year % 100)};
+	return i2c.write(DS3231_ADDRESS, DS3231_DATE_REGISTER, regs, sizeof(regs), I2C_FAST_CLOCK);
+}
+
+char* Rtc::getTimeStr()
+{
+	static char str[8]; // room for three digits each, should a garbled read decode to more than 99
+	Time t = getTime();
+	sprintf(str, "%02d:%02d", t.hour, t.min);
+	return str;
+}
+
+char* Rtc::getDateStr()
+{
+	static char str[14]; // as above
+	Time t = getTime();
+	sprintf(str, "%04d/%02d/%02d", t.year, t.mon, t.date);
+	return str;
+}
+
+float Rtc::getTemp()
+{
+	byte regs[2];
+	if (i2c.read(DS3231_ADDRESS, DS3231_TEMP_REGISTER, regs, sizeof(regs), I2C_FAST_CLOCK))
+		m_temp = (int8_t)regs[0] + (regs[1] >> 6) * 0.25;
+	return m_temp;
+}
@@ -0,0 +1,40 @@
+#ifndef RTC_H
+#define RTC_H
+
+#include <arduino.h>
+
+#define DS3231_ADDRESS 0x68
+#define DS3231_TIME_REGISTER 0x00	// seconds, minutes, hours, day of week, date, month, year (BCD)
+#define DS3231_DATE_REGISTER 0x04
+#define DS3231_TEMP_REGISTER 0x11	// whole degrees (signed), then quarters in the top two bits
+
+struct Time
+{
+	byte hour;
+	byte min;
+	byte sec;
+	byte date;
+	byte mon;
+	uint16_t year;
+	byte dow;
+};
+
+// DS3231 on the shared I2C bus (see I2CBus.h), at I2C_FAST_CLOCK. Replaces the Rinky-Dink DS3231 library,
+// whose transactions wait forever for the bus. If a read fails, the last good value is returned.
+class Rtc
+{
+public:
+	Rtc();
+	Time getTime();
+	bool setTime(byte hour, byte minute, byte second);	// False if a value is out of range or the write failed
+	bool setDate(byte day, byte month, uint16_t year);	// Years 2000 to 2099
+	char* getTimeStr();		// "hh:mm"
+	char* getDateStr();		// "yyyy/mm/dd"
+	float getTemp();
+
+private:
+	Time m_time;
+	float m_temp;
+};
+
+#endif // RTC_H
@@ -0,0 +1,130 @@
+#include "Schedule.h"
+
+Schedule::Schedule() : m_ruleCount(0), m_day(SCHEDULE_NO_DAY), m_count(0), m_overnight(false), m_passed(0)
+{}
+
+void Schedule::setRule(byte i, byte anchor, int minute, bool open, byte days)
+{
+	m_rules[i].anchor = anchor;
+	m_rules[i].minute = minute;
+	m_rules[i].open = open;
+	m_rules[i].days = days;
+	if (i >= m_ruleCount)
+		m_ruleCount = i + 1;
+	invalidate();
+}
+
+bool Schedule::addRule(byte anchor, int minute, bool open, byte days)
+{
+	if (m_ruleCount >= SCHEDULE_MAX_RULES)
+		return false;
+
+	setRule(m_ruleCount, anchor, minute, open, days);
+	return true;
+}
+
+void Schedule::clearRules(byte keep)
+{
+	if (keep < m_ruleCount)
+		m_ruleCount = keep;
+	invalidate();
+}
+
+// The rules are sorted by insertion: there are only a handful, and it keeps rules at the same minute in order
+void Schedule::compile(unsigned int day, byte weekday, int sunrise, int sunset, int sunrise_before, int sunset_before)
+{
+	m_count = 0;
+	for (byte r = 0; r < m_ruleCount; r++)
+	{
+		if (!m_applies(m_rules[r], weekday))
+			continue;
+
+		int minute = m_minute(m_rules[r], sunrise, sunset);
+		byte i = m_count++;
+		while (i > 0 && m_transitions[i - 1].minute > minute)
+		{
+			m_transitions[i] = m_transitions[i - 1];
+			i--;
+		}
+		m_transitions[i].minute = minute;
+		m_transitions[i].open = m_rules[r].open;
+	}
+
+	// Only the last transition of the day before matters, so it is not sorted
+	byte weekday_before = (weekday + 6) % 7;
+	int latest = -1;
+	m_overnight = false;
+	for (byte r = 0; r < m_ruleCount; r++)
+	{
+		if (!m_applies(m_rules[r], weekday_before))
+			continue;
+
+		int minute = m_minute(m_rules[r], sunrise_before, sunset_before);
+		if (minute >= latest)
+		{
+			latest = minute;
+			m_overnight = m_rules[r].open;
+		}
+	}
+
+	m_day = day;
+	m_passed = 0;
+}
+
+// Binary search, unless minute is still between the transitions the last answer was found between
+byte Schedule::passed(int minute)
+{
+	if ((m_passed == 0 || m_transitions[m_passed - 1].minute <= minute) &&
+		(m_passed == m_count || minute < m_transitions[m_passed].minute))
+		return m_passed;
+
+	byte low = 0;
+	byte high = m_count;
+	while (low < high)
+	{
+		byte mid = (low + high) / 2;
+		if (m_transitions[mid].minute <= minute)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	m_passed = low;
+	return low;
+}
+
+bool Schedule::isOpen(int minute)
+{
+	byte i = passed(minute);
+	return i ? m_transitions[i - 1].open : m_overnight;
+}
+
+int Schedule::next(int minute, bool open)
+{
+	for (byte i = passed(minute); i < m_count; i++)
+	{
+		if (m_transitions[i].open == open)
+			return m_transitions[i].minute;
+	}
+	for (byte i = 0; i < m_count; i++)
+	{
+		if (m_transitions[i].open == open)
+			return m_transitions[i].minute;
+	}
+	return -1;
+}
+
+// A rule that falls outside the day (a large delay, or a time zone far from UTC) happens at its first or last minute
+int Schedule::m_minute(const ScheduleRule& rule, int sunrise, int sunset) const
+{
+	int minute = rule.minute;
+	if (rule.anchor == RULE_SUNRISE)
+		minute += sunrise;
+	else if (rule.anchor == RULE_SUNSET)
+		minute += sunset;
+
+	if (minute < 0)
+		return 0;
+	if (minute >= MINUTES_PER_DAY)
+		return MINUTES_PER_DAY - 1;
+	return minute;
+}
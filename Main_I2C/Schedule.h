@@ -0,0 +1,75 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <arduino.h>
+
+#define SCHEDULE_MAX_RULES 8	// including the sunrise and sunset rules that Clock keeps in the first two places
+#define MINUTES_PER_DAY 1440
+#define SCHEDULE_NO_DAY 0xFFFF	// nothing compiled yet
+
+// What the minute of a rule counts from
+#define RULE_SUNRISE 0
+#define RULE_SUNSET 1
+#define RULE_TIME 2		// midnight, local time
+
+// Days a rule applies to, bit 0 = Sunday
+#define EVERY_DAY 0x7F
+#define WEEKDAYS 0x3E
+#define WEEKENDS 0x41
+
+struct ScheduleRule
+{
+	byte anchor;		// RULE_SUNRISE, RULE_SUNSET or RULE_TIME
+	int16_t minute;		// from the anchor
+	bool open;			// the doors open at that time, or close
+	byte days;
+};
+
+struct Transition
+{
+	int16_t minute;		// of the day, local time
+	bool open;
+};
+
+// Times of the day at which the doors open or close. The rules are compiled once a day (and whenever they change) into
+// a list of transitions sorted by time, so whether the doors should be open is a binary search however many rules
+// there are, and usually not even that: until the next transition is due, the last answer still holds.
+// The doors stay as the latest transition left them. Before the first one of a day, that is the last one of the day
+// before. Rules at the same minute apply in the order they were added, so the last one wins.
+class Schedule
+{
+public:
+	Schedule();
+	void setRule(byte i, byte anchor, int minute, bool open, byte days = EVERY_DAY);
+	bool addRule(byte anchor, int minute, bool open, byte days = EVERY_DAY);	// Returns false if there is no room left
+	void clearRules(byte keep);		// Removes all rules after the first keep
+	byte ruleCount() const {return m_ruleCount;}
+
+	// day only identifies the compiled day (see compiled()). weekday is 0 for Sunday. Sunrise and sunset are minutes
+	// of the day, local time.
+	void compile(unsigned int day, byte weekday, int sunrise, int sunset, int sunrise_before, int sunset_before);
+	bool compiled(unsigned int day) const {return m_day == day;}
+	void invalidate() {m_day = SCHEDULE_NO_DAY;}
+
+	// Queries on the compiled day
+	byte count() const {return m_count;}
+	const Transition& get(byte i) const {return m_transitions[i];}
+	byte passed(int minute);		// Number of transitions at or before minute
+	bool isOpen(int minute);
+	int next(int minute, bool open);	// Minute of the next opening (or closing) after minute, or of the first one of the day if there is none left. -1 if there is none at all.
+
+private:
+	ScheduleRule m_rules[SCHEDULE_MAX_RULES];
+	byte m_ruleCount;
+
+	unsigned int m_day;
+	Transition m_transitions[SCHEDULE_MAX_RULES];	// a rule makes at most one transition a day
+	byte m_count;
+	bool m_overnight;		// what the last transition of the day before left the doors as
+	byte m_passed;			// answer to the last passed(), valid from m_transitions[m_passed - 1] until m_transitions[m_passed]
+
+	bool m_applies(const ScheduleRule& rule, byte weekday) const {return rule.days & (1 << weekday);}
+	int m_minute(const ScheduleRule& rule, int sunrise, int sunset) const;
+};
+
+#endif // SCHEDULE_H
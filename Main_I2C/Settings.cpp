@@ -0,0 +1,133 @@
+#include "Settings.h"
+#include <EEPROM.h>
+#include "EEPROM_ADDRESSES.h"
+#include "Classes.h"
+
+Settings::Settings() : m_journal(SETTINGS_JOURNAL_ADDR, SETTINGS_JOURNAL_SIZE, SETTINGS_SLOT_SIZE), m_pending(false), m_lastChange(0)
+{
+	m_setDefaults();
+	m_stored = m_data;
+}
+
+bool Settings::load()
+{
+	// Fields missing from a shorter (older) record keep their defaults
+	m_setDefaults();
+	byte length = m_journal.load(&m_data, sizeof(m_data));
+	bool found = (length > 0);
+
+	if (!found)
+	{
+		// First boot after upgrading from the fixed-address layout
+		found = m_loadLegacy();
+		if (found)
+			m_data.version = SETTINGS_LEGACY_VERSION;
+	}
+
+	byte version = m_data.version;
+	if (found)
+		m_migrate(version);
+	m_validate();
+
+	// Nothing is stored yet, or it is stored in an older format
+	if (!found || version != SETTINGS_VERSION || length != sizeof(m_data))
+		memset(&m_stored, 0xFF, sizeof(m_stored));
+	else
+		m_stored = m_data;
+
+	if (found && version != SETTINGS_VERSION)
+		commit();
+
+	return found;
+}
+
+void Settings::commit()
+{
+	m_pending = false;
+	if (memcmp(&m_data, &m_stored, sizeof(m_data)) == 0)
+		return;
+
+	if (m_journal.save(&m_data, sizeof(m_data)))
+		m_stored = m_data;
+}
+
+void Settings::setStepsToClose(byte door, unsigned int steps)
+{
+	if (door == 0)
+		m_data.stepsToClose = steps;
+	else
+		m_data.moreStepsToClose[door - 1] = steps;
+}
+
+void Settings::requestCommit()
+{
+	m_pending = true;
+	m_lastChange = millis();
+}
+
+void Settings::m_setDefaults()
+{
+	m_data.version = SETTINGS_VERSION;
+	m_data.timezone = DEFAULT_TIMEZONE;
+	m_data.openDelay = DEFAULT_OPEN_DELAY;
+	m_data.closeDelay = DEFAULT_CLOSE_DELAY;
+	m_data.stepsToClose = DEFAULT_STEPS_TO_CLOSE;
+	m_data.doorOpen = false;
+	m_data.openStepMode = DEFAULT_OPEN_STEP_MODE;
+	m_data.closeStepMode = DEFAULT_CLOSE_STEP_MODE;
+	for (byte i = 0; i < MAX_DOORS - 1; i++)
+		m_data.moreStepsToClose[i] = DEFAULT_STEPS_TO_CLOSE;
+}
+
+// Returns false if the old addresses were never written (blank EEPROM reads 0xFF everywhere)
+bool Settings::m_loadLegacy()
+{
+	uint16_t stepsToClose;
+	EEPROM.get(LEGACY_STEPS_TO_CLOSE_EEPROM_ADDR, stepsToClose);
+	byte doorState = EEPROM.read(LEGACY_DOOR_STATE_EEPROM_ADDR);
+	if (stepsToClose == 0xFFFF && doorState == 0xFF)
+		return false;
+
+	m_data.timezone = EEPROM.read(LEGACY_TIMEZONE_EEPROM_ADDR);
+	m_data.openDelay = EEPROM.read(LEGACY_OPEN_DELAY_EEPROM_ADDR);
+	m_data.closeDelay = EEPROM.read(LEGACY_CLOSE_DELAY_EEPROM_ADDR);
+	m_data.stepsToClose = stepsToClose;
+	m_data.doorOpen = (doorState == 1);
+	return true;
+}
+
+// Brings a record written by older firmware up to SETTINGS_VERSION, one version at a time.
+// Each case falls through to the next one.
+void Settings::m_migrate(byte version)
+{
+	switch (version)
+	{
+		case SETTINGS_LEGACY_VERSION:
+			// Same fields as version 1, already copied by m_loadLegacy()
+		default:
+			break;
+	}
+	m_data.version = SETTINGS_VERSION;
+}
+
+// Replaces any out of range value with its default
+void Settings::m_validate()
+{
+	if (m_data.timezone < MIN_TIMEZONE || m_data.timezone > MAX_TIMEZONE)
+		m_data.timezone = DEFAULT_TIMEZONE;
+
+	if (m_data.stepsToClose < 1 || m_data.stepsToClose > MAX_STEPS)
+		m_data.stepsToClose = DEFAULT_STEPS_TO_CLOSE;
+
+	for (byte i = 0; i < MAX_DOORS - 1; i++)
+	{
+		if (m_data.moreStepsToClose[i] < 1 || m_data.moreStepsToClose[i] > MAX_STEPS)
+			m_data.moreStepsToClose[i] = DEFAULT_STEPS_TO_CLOSE;
+	}
+
+	if (m_data.openStepMode > HALF_STEP)
+		m_data.openStepMode = DEFAULT_OPEN_STEP_MODE;
+
+	if (m_data.closeStepMode > HALF_STEP)
+		m_data.closeStepMode = DEFAULT_CLOSE_STEP_MODE;
+}
@@ -0,0 +1,82 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <arduino.h>
+#include "Journal.h"
+#include "StepperDriver.h"
+#include "EEPROM_ADDRESSES.h"
+
+// Bump when the meaning of an existing field changes, and add a case to Settings::m_migrate().
+// Adding a field at the end of SettingsData does not need a new version: older records are just shorter.
+#define SETTINGS_VERSION 1
+#define SETTINGS_LEGACY_VERSION 0 // fixed-address layout used before the journal
+
+#define SETTINGS_COMMIT_DELAY 5000 // Menu edits are written once nothing has changed for this long (in milliseconds)
+
+// Defaults used when EEPROM is blank or corrupt
+#define DEFAULT_TIMEZONE 0
+#define DEFAULT_OPEN_DELAY 0
+#define DEFAULT_CLOSE_DELAY 0
+#define DEFAULT_STEPS_TO_CLOSE 200
+#define DEFAULT_OPEN_STEP_MODE FULL_STEP	// full torque to lift the door
+#define DEFAULT_CLOSE_STEP_MODE WAVE_DRIVE	// gravity helps on the way down, so half the current is enough
+
+#define MIN_TIMEZONE -12
+#define MAX_TIMEZONE 14
+
+// Everything that has to survive a loss of power. Loaded from the settings journal as one block and kept in RAM.
+// New fields go at the end.
+struct SettingsData
+{
+	byte version;
+	signed_byte timezone;
+	signed_byte openDelay;
+	signed_byte closeDelay;
+	uint16_t stepsToClose;
+	bool doorOpen;			// only read once when upgrading: the door keeps its state in its own position journal now
+	byte openStepMode;		// see StepperDriver.h
+	byte closeStepMode;
+	uint16_t moreStepsToClose[MAX_DOORS - 1];	// calibration of the doors after the first one
+} __attribute__((packed));
+
+// Fixed-size fields only: the record has to have the same layout, and fit its slot, on the host as on the board
+static_assert(sizeof(SettingsData) <= JOURNAL_MAX_DATA(SETTINGS_SLOT_SIZE), "SettingsData does not fit a settings journal slot");
+
+class Settings
+{
+public:
+	Settings();
+	bool load();			// Returns false if no valid record was found and defaults are being used.
+	void commit();			// Writes the settings now, if they differ from what is stored.
+	void requestCommit();	// Writes the settings after SETTINGS_COMMIT_DELAY, so that a burst of edits costs one write.
+	bool commitDue() const {return m_pending && (millis() - m_lastChange >= SETTINGS_COMMIT_DELAY);}
+
+	signed_byte getTimezone() const {return m_data.timezone;}
+	signed_byte getOpenDelay() const {return m_data.openDelay;}
+	signed_byte getCloseDelay() const {return m_data.closeDelay;}
+	unsigned int getStepsToClose(byte door = 0) const {return door ? m_data.moreStepsToClose[door - 1] : m_data.stepsToClose;}
+	bool getDoorOpen() const {return m_data.doorOpen;}
+	byte getOpenStepMode() const {return m_data.openStepMode;}
+	byte getCloseStepMode() const {return m_data.closeStepMode;}
+
+	void setTimezone(signed_byte tzone) {m_data.timezone = tzone;}
+	void setOpenDelay(signed_byte delay) {m_data.openDelay = delay;}
+	void setCloseDelay(signed_byte delay) {m_data.closeDelay = delay;}
+	void setStepsToClose(byte door, unsigned int steps);
+	void setDoorOpen(bool state) {m_data.doorOpen = state;}
+	void setStepModes(byte open_mode, byte close_mode) {m_data.openStepMode = open_mode; m_data.closeStepMode = close_mode;}
+
+private:
+	SettingsData m_data;
+	SettingsData m_stored;	// copy of what is in EEPROM, to skip writes that would not change anything
+	Journal m_journal;
+	bool m_pending;
+	unsigned long m_lastChange;
+
+	void m_setDefaults();
+	bool m_loadLegacy();
+	void m_migrate(byte version);
+	void m_validate();
+};
+
+#endif // SETTINGS_H
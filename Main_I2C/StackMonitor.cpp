@@ -0,0 +1,46 @@
+#include "StackMonitor.h"
+
+extern char __heap_start;
+extern char* __brkval;
+
+#if EXPERIMENTAL_STACK_PAINT
+// Runs before the global constructors and main(), once the stack pointer is set up (.init3),
+// and fills everything between the static data and the stack with STACK_CANARY.
+// Naked, so it has no prologue and falls through to the next init section.
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack()
+{
+	byte* p = (byte*)&__heap_start;
+	while (p < (byte*)SP)
+		*p++ = STACK_CANARY;
+}
+#endif
+
+// Top of the heap, or the end of the static data if nothing was allocated
+static const byte* heapEnd()
+{
+	return (__brkval == 0) ? (const byte*)&__heap_start : (const byte*)__brkval;
+}
+
+// Neither the heap nor the stack has touched the canary bytes above the heap
+unsigned int stackHeadroom()
+{
+	if (!EXPERIMENTAL_STACK_PAINT)
+		return (unsigned int)((const byte*)SP - heapEnd());
+
+	const byte* p = heapEnd();
+	unsigned int n = 0;
+	while (p < (const byte*)SP && *p == STACK_CANARY)
+	{
+		p++;
+		n++;
+	}
+	return n;
+}
+
+#if EXPERIMENTAL_STACK_PAINT
+unsigned int stackHighWater()
+{
+	return (unsigned int)(RAMEND + 1 - (unsigned int)heapEnd() - stackHeadroom());
+}
+#endif
@@ -0,0 +1,19 @@
+#ifndef STACKMONITOR_H
+#define STACKMONITOR_H
+
+#include <arduino.h>
+#include "Profile.h"
+
+#define STACK_CANARY 0xC5			// free SRAM is filled with this at boot
+#define SRAM_WARNING_THRESHOLD 128	// headroom (in bytes) below which a low memory event is raised
+
+// freeMemory() (FreeMemory.h) only sees the gap at the moment it is called. With EXPERIMENTAL_STACK_PAINT, these look
+// at the painted area instead, so they also catch the deepest the stack has been since boot (e.g. in the middle of a
+// door move). Without it, there is no high water mark to be had, and stackHeadroom() sees the gap at the moment it is
+// called too.
+unsigned int stackHeadroom();		// Smallest gap there has been between the heap and the stack, in bytes.
+#if EXPERIMENTAL_STACK_PAINT
+unsigned int stackHighWater();		// Most stack used since boot, in bytes.
+#endif
+
+#endif // STACKMONITOR_H
@@ -0,0 +1,258 @@
+#include "StepperDriver.h"
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+// Half-step sequence for IN1-IN4 (coil A is IN1/IN2, coil B is IN3/IN4).
+// Even entries energise both coils (full step), odd entries one coil (wave drive).
+const byte halfStepTable[8] PROGMEM = {0b1010, 0b0010, 0b0110, 0b0100, 0b0101, 0b0001, 0b1001, 0b1000};
+
+// Drivers in the order they were made. The first one gets compare channel A of Timer1, the second channel B.
+static StepperDriver* channels[STEPPER_CHANNELS];
+static byte channelCount = 0;
+
+#if defined(__AVR__)
+ISR(TIMER1_COMPA_vect)
+{
+	channels[0]->onInterrupt();
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+	channels[1]->onInterrupt();
+}
+#endif
+
+StepperDriver::StepperDriver(int steps_per_rev, void (*write)(byte pattern)) : m_write(write),
+m_phase(0), m_mode(FULL_STEP), m_coils(0), m_stepsPerRev(steps_per_rev), m_stepDelay(0), m_lastStepTime(0), m_coilMicros(0),
+m_ramp(NULL), m_rampLength(0), m_channel(channelCount), m_running(false), m_remaining(0), m_taken(0), m_direction(1),
+m_halfDone(false), m_stopSeen(false), m_stop(NULL), m_interval(0), m_runDelay(0)
+{
+	if (channelCount < STEPPER_CHANNELS)
+		channels[channelCount++] = this;
+	m_write(0);
+}
+
+void StepperDriver::setSpeed(long rpm)
+{
+	m_stepDelay = 60L * 1000L * 1000L / m_stepsPerRev / rpm;
+}
+
+void StepperDriver::step(int steps)
+{
+	signed_byte direction = (steps > 0) ? 1 : -1;
+	unsigned int n = (steps > 0) ? steps : -steps;
+	if (n == 0)
+		return;
+
+	if (m_mode == HALF_STEP)
+	{
+		for (unsigned int i = 0; i < 2*n; i++)
+			m_advance(direction, m_stepDelay / 2);
+		return;
+	}
+
+	// Full step uses the even entries of the table and wave drive the odd ones. Coming from the other kind,
+	// the first move is half a step.
+	bool odd = (m_phase & 1);
+	if (odd != (m_mode == WAVE_DRIVE))
+		m_advance(direction, m_stepDelay / 2);
+
+	for (unsigned int i = 0; i < n; i++)
+		m_advance(2*direction, m_stepDelay);
+}
+
+void StepperDriver::release()
+{
+	m_account();
+	m_write(0);
+	m_coils = 0;
+}
+
+void StepperDriver::run(signed_byte direction, unsigned int steps, const Pin* stop, unsigned int step_us)
+{
+	m_direction = direction;
+	m_runDelay = step_us ? step_us : m_stepDelay;
+	m_stop = stop;
+	m_stopSeen = stop && stop->read();
+	m_taken = 0;
+	m_remaining = steps;
+	m_running = false;
+	if (steps > 0 && !m_stopSeen)
+		m_start();
+}
+
+void StepperDriver::extend(unsigned int steps)
+{
+#if defined(__AVR__)
+	byte sreg = SREG;
+	cli();
+#endif
+	m_remaining += steps;
+	bool restart = !m_running && !m_stopSeen && steps > 0;
+#if defined(__AVR__)
+	SREG = sreg;
+#endif
+	if (restart)
+		m_start();
+}
+
+bool StepperDriver::running()
+{
+#if !defined(__AVR__)
+	while (m_running && micros() - m_lastStepTime >= m_interval)
+		onInterrupt();
+#endif
+	return m_running;
+}
+
+unsigned int StepperDriver::stepsTaken() const
+{
+#if defined(__AVR__)
+	byte sreg = SREG;
+	cli();
+	unsigned int taken = m_taken;
+	SREG = sreg;
+	return taken;
+#else
+	return m_taken;
+#endif
+}
+
+// One coil change of a run: a whole step, or half of one in half step mode
+void StepperDriver::onInterrupt()
+{
+	if (!m_halfDone)
+	{
+		if (m_stopSeen)
+		{
+			m_finish();
+			return;
+		}
+		if (m_stop)
+			m_stopSeen = m_stop->read(); // this step is still taken, like the last step of Door's old stepping loop
+
+		if (m_mode == HALF_STEP)
+		{
+			m_set(m_direction);
+			m_halfDone = true;
+			m_schedule();
+			return;
+		}
+		m_set(2*m_direction);
+	}
+	else
+	{
+		m_set(m_direction);
+		m_halfDone = false;
+	}
+
+	m_taken++;
+	if (--m_remaining == 0)
+	{
+		m_finish();
+		return;
+	}
+	m_interval = (m_mode == HALF_STEP) ? m_stepInterval() / 2 : m_stepInterval();
+	m_schedule();
+}
+
+unsigned long StepperDriver::energy() const
+{
+	// E = V * I * t, with t in coil-milliseconds
+	unsigned long coil_ms = m_coilMicros / 1000;
+	return (coil_ms * COIL_CURRENT_MA / 1000) * MOTOR_SUPPLY_MV / 1000;
+}
+
+// Waits until delay_us after the previous change, then moves half_steps entries along the table
+void StepperDriver::m_advance(signed_byte half_steps, unsigned long delay_us)
+{
+	while (micros() - m_lastStepTime < delay_us)
+	{}
+
+	m_set(half_steps);
+}
+
+void StepperDriver::m_set(signed_byte half_steps)
+{
+	m_account();
+	m_phase = (m_phase + half_steps) & 0x07;
+
+	byte pattern = pgm_read_byte(&halfStepTable[m_phase]);
+	m_write(pattern);
+	m_coils = (m_phase & 1) ? 1 : 2; // see halfStepTable
+}
+
+// Adds the time the current coils have been on to the energy total
+void StepperDriver::m_account()
+{
+	unsigned long now = micros();
+	m_coilMicros += m_coils * (now - m_lastStepTime);
+	m_lastStepTime = now;
+}
+
+// The first steps of a run follow the ramp, and so do the last ones, backwards. The ramp never makes a step faster.
+unsigned int StepperDriver::m_stepInterval() const
+{
+	unsigned int i = (m_taken < m_remaining) ? m_taken : m_remaining - 1;
+	unsigned long interval = m_runDelay;
+	if (m_ramp && i < m_rampLength && pgm_read_word(&m_ramp[i]) > interval)
+		interval = pgm_read_word(&m_ramp[i]);
+	if (interval > STEPPER_MAX_INTERVAL)
+		interval = STEPPER_MAX_INTERVAL;
+	return interval;
+}
+
+void StepperDriver::m_start()
+{
+	// As in step(), coming from the other kind of step the first move is half a step. It is made straight away.
+	bool odd = (m_phase & 1);
+	if (m_mode != HALF_STEP && odd != (m_mode == WAVE_DRIVE))
+		m_set(m_direction);
+
+	m_halfDone = false;
+	m_interval = (m_mode == HALF_STEP) ? m_stepInterval() / 2 : m_stepInterval();
+	m_account(); // the interval counts from now
+	m_running = true;
+#if defined(__AVR__)
+	byte sreg = SREG;
+	cli();
+	// Normal mode, prescaler 8. init() had set Timer1 up for PWM, which the sketch does not use.
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);
+	unsigned int at = TCNT1 + m_interval * STEPPER_TICKS_PER_US;
+	if (m_channel == 0)
+	{
+		OCR1A = at;
+		TIFR1 = _BV(OCF1A);
+		TIMSK1 |= _BV(OCIE1A);
+	}
+	else
+	{
+		OCR1B = at;
+		TIFR1 = _BV(OCF1B);
+		TIMSK1 |= _BV(OCIE1B);
+	}
+	SREG = sreg;
+#endif
+}
+
+// The compare register moves on by the interval from its last value, not from now, so a late interrupt does not make
+// the next step late too
+void StepperDriver::m_schedule()
+{
+#if defined(__AVR__)
+	if (m_channel == 0)
+		OCR1A += m_interval * STEPPER_TICKS_PER_US;
+	else
+		OCR1B += m_interval * STEPPER_TICKS_PER_US;
+#endif
+}
+
+void StepperDriver::m_finish()
+{
+	m_running = false;
+#if defined(__AVR__)
+	TIMSK1 &= (m_channel == 0) ? ~_BV(OCIE1A) : ~_BV(OCIE1B);
+#endif
+}
@@ -0,0 +1,114 @@
+#ifndef STEPPERDRIVER_H
+#define STEPPERDRIVER_H
+
+#include <arduino.h>
+#include "FastPin.h"
+
+#define signed_byte int8_t // equivalent to 'char' but more clear
+
+// Stepping modes
+#define WAVE_DRIVE 0	// one coil at a time: half the current of full step, less torque
+#define FULL_STEP 1		// two coils at a time: full torque (what the Stepper library does)
+#define HALF_STEP 2		// alternates one and two coils: smoother, twice as many (half-size) steps
+
+// Timer-driven runs use Timer1 in normal mode, with a prescaler of 8, and one of its compare channels per driver
+#define STEPPER_CHANNELS 2
+#define STEPPER_TICKS_PER_US (F_CPU / 8000000UL)
+#define STEPPER_MAX_INTERVAL 30000	// (microseconds) longest step the 16 bit compare register can time
+
+// Used to estimate the energy of a move (see energy())
+#define COIL_CURRENT_MA 400
+#define MOTOR_SUPPLY_MV 12000
+
+// The four pins of a driver (IN1-IN4), given as template arguments so that they are known at compile time: each coil
+// change, made in the timer interrupt, is then four single instructions (see FastPin.h).
+// StepperDriver motor(200, StepperPins<11, 10, 9, 8>());
+template <uint8_t COIL_A1, uint8_t COIL_A2, uint8_t COIL_B1, uint8_t COIL_B2>
+struct StepperPins
+{
+	static void output()
+	{
+		FastPin<COIL_A1>::output();
+		FastPin<COIL_A2>::output();
+		FastPin<COIL_B1>::output();
+		FastPin<COIL_B2>::output();
+	}
+
+	// COIL_A1 (IN1) is bit 3 of pattern, COIL_B2 (IN4) bit 0
+	static void write(byte pattern)
+	{
+		FastPin<COIL_A1>::write(pattern & 0b1000);
+		FastPin<COIL_A2>::write(pattern & 0b0100);
+		FastPin<COIL_B1>::write(pattern & 0b0010);
+		FastPin<COIL_B2>::write(pattern & 0b0001);
+	}
+};
+
+// Drives a bipolar stepper through an L298N on four pins (IN1-IN4). Replaces the Stepper library,
+// which only does full steps and leaves the coils energised after the last step.
+// step() blocks, like the Stepper library. run() steps in the background instead: on the AVR each coil change is made
+// by a Timer1 compare interrupt at its exact time, whatever the sketch is doing. On the host, running() makes the
+// changes that are due, so the simulator needs no timer.
+class StepperDriver
+{
+public:
+	template <uint8_t COIL_A1, uint8_t COIL_A2, uint8_t COIL_B1, uint8_t COIL_B2>
+	StepperDriver(int steps_per_rev, StepperPins<COIL_A1, COIL_A2, COIL_B1, COIL_B2>) :
+	StepperDriver(steps_per_rev, &StepperPins<COIL_A1, COIL_A2, COIL_B1, COIL_B2>::write)
+	{
+		StepperPins<COIL_A1, COIL_A2, COIL_B1, COIL_B2>::output(); // after the pins have been set low
+	}
+	void setSpeed(long rpm);
+	void setMode(byte mode) {m_mode = mode;}
+	void step(int steps);					// Always in full steps, whatever the mode. Blocks until done, like Stepper::step().
+	void release();							// De-energises all coils
+
+	// ramp is a table in PROGMEM of step intervals in microseconds: the first steps of a run follow it, and so do the
+	// last ones of a run of known length, backwards. No step is slower than setSpeed() allows.
+	void setRamp(const uint16_t* ramp, byte length) {m_ramp = ramp; m_rampLength = length;}
+	// Stops after steps, or after the step on which stop first reads HIGH. step_us, if given, is the step interval for
+	// this run instead of the one set by setSpeed().
+	void run(signed_byte direction, unsigned int steps, const Pin* stop = NULL, unsigned int step_us = 0);
+	void extend(unsigned int steps);		// More steps for the run, which is restarted if it had used them all
+	bool running();
+	unsigned int stepsTaken() const;		// since run()
+	void onInterrupt();						// timer compare interrupt of this driver's channel
+
+	void resetEnergy() {m_coilMicros = 0;}
+	unsigned long energy() const;			// Estimated energy since resetEnergy(), in millijoules
+
+private:
+	void (*m_write)(byte pattern);	// StepperPins<...>::write
+	byte m_phase;				// index into the half-step table
+	byte m_mode;
+	byte m_coils;				// coils currently energised
+	int m_stepsPerRev;
+	unsigned long m_stepDelay;	// in microseconds, per full step
+	unsigned long m_lastStepTime;	// time of the last coil change
+	unsigned long m_coilMicros;	// sum over coils of the time each one was energised
+
+	// Timer-driven run. Everything here is shared with the interrupt.
+	const uint16_t* m_ramp;
+	byte m_rampLength;
+	byte m_channel;				// Timer1 compare channel (0 = A, 1 = B)
+	volatile bool m_running;
+	volatile unsigned int m_remaining;
+	volatile unsigned int m_taken;
+	signed_byte m_direction;
+	bool m_halfDone;			// in half step mode, the first half of the current step has been made
+	bool m_stopSeen;			// the stop pin read HIGH before the last step
+	const Pin* m_stop;
+	unsigned int m_interval;	// in microseconds, until the next coil change
+	unsigned long m_runDelay;	// in microseconds, per full step of this run
+
+	StepperDriver(int steps_per_rev, void (*write)(byte pattern));
+	void m_advance(signed_byte half_steps, unsigned long delay_us);
+	void m_set(signed_byte half_steps);
+	void m_account();
+	unsigned int m_stepInterval() const;
+	void m_start();
+	void m_schedule();
+	void m_finish();
+};
+
+#endif // STEPPERDRIVER_H
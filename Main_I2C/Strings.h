@@ -26,11 +26,19 @@ const char str16[] PROGMEM = " Hold R to save ";
 const char str17[] PROGMEM = "     < ";
 const char str18[] PROGMEM = " >    ";
 const char str19[] PROGMEM = "complete.       ";
-const char str20[] PROGMEM = "                ";
-const char str21[] PROGMEM = "                ";
-const char str22[] PROGMEM = "                ";
-const char str23[] PROGMEM = "                ";
-const char str24[] PROGMEM = "                ";
+const char str20[] PROGMEM = "Hold R to change";
+const char str21[] PROGMEM = "Hold R/L for ma-";
+const char str22[] PROGMEM = "nual open/close.";
+const char str23[] PROGMEM = "calibrate door.";
+const char str24[] PROGMEM = "Close door. Hold";
+const char str25[] PROGMEM = "R to continue.";
+const char str26[] PROGMEM = "open delay (";
+const char str27[] PROGMEM = "close delay(";
+const char str28[] PROGMEM = "timezone (";
+const char str29[] PROGMEM = "time (";
+const char str30[] PROGMEM = "date(";
+const char str31[] PROGMEM = "door (";
+const char str32[] PROGMEM = "failed.         ";
 #define WELCOME_MSG 0
 #define DOOR_OPENING_MSG 1
 #define DOOR_CLOSING_MSG 2
@@ -51,8 +59,21 @@ const char str24[] PROGMEM = "                ";
 #define LEFT_ARROW_MSG 17
 #define RIGHT_ARROW_MSG 18
 #define COMPLETE_MSG 19
+#define HOLD_R_CHANGE_MSG 20
+#define MANUAL_MODIFY_MSG 21
+#define MANUAL_MODIFY2_MSG 22
+#define CALIBRATE_DOOR_MSG 23
+#define CLOSE_DOOR_HOLD_MSG 24
+#define R_TO_CONTINUE_MSG 25
+#define OPEN_DELAY_LABEL_MSG 26
+#define CLOSE_DELAY_LABEL_MSG 27
+#define TIMEZONE_LABEL_MSG 28
+#define TIME_LABEL_MSG 29
+#define DATE_LABEL_MSG 30
+#define DOOR_LABEL_MSG 31
+#define FAILED_MSG 32
 
-const char* const string_table[] PROGMEM = {str00, str01, str02, str03, str04, str05, str06, str07, str08, str09, str10, str11, str12, str13, str14, str15, str16, str17, str18, str19, str20, str21, str22, str23, str24};
+const char* const string_table[] PROGMEM = {str00, str01, str02, str03, str04, str05, str06, str07, str08, str09, str10, str11, str12, str13, str14, str15, str16, str17, str18, str19, str20, str21, str22, str23, str24, str25, str26, str27, str28, str29, str30, str31, str32};
 void printMessage(LiquidCrystal_I2C* lcd, int message, bool clear = true);
 
 #endif // STRINGS_H
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <arduino.h>
+
+// Stackless coroutines, in the style of protothreads. A task is a function that is called again and again (by
+// EventHandler::runTasks(), or by a listener) and picks up where it left off, so a long operation can be written as
+// sequential code that gives loop() back at every wait:
+//
+//	Task blink;
+//	bool blinkTask()
+//	{
+//		TASK_BEGIN(blink);
+//		digitalWrite(LED, HIGH);
+//		TASK_DELAY(blink, 500);
+//		digitalWrite(LED, LOW);
+//		TASK_END(blink);
+//	}
+//
+// The function returns false while it is waiting and true once it has finished (the next call starts it again).
+// Local variables do not survive a wait: keep state in globals or members. A task cannot use switch statements of
+// its own, nor put two waits on one line (the macros are built on a switch and __LINE__).
+struct Task
+{
+	Task() : line(0), since(0) {}
+	bool running() const {return line != 0;}	// stopped at a wait
+	void reset() {line = 0;}					// the next call starts from the beginning
+
+	unsigned int line;		// where to resume, 0 = from the beginning
+	unsigned long since;	// when the current TASK_DELAY started
+};
+
+#define TASK_BEGIN(t) switch ((t).line) { case 0:
+#define TASK_END(t) } (t).line = 0; return true
+
+// Gives loop() back once
+#define TASK_YIELD(t) do { (t).line = __LINE__; return false; case __LINE__:; } while (0)
+
+// Gives loop() back until the condition is true
+#define TASK_WAIT_UNTIL(t, condition) do { (t).line = __LINE__; case __LINE__: if (!(condition)) return false; } while (0)
+
+// Gives loop() back for a while (in milliseconds)
+#define TASK_DELAY(t, ms) do { (t).since = millis(); (t).line = __LINE__; case __LINE__: if (millis() - (t).since < (ms)) return false; } while (0)
+
+// Finishes the task early
+#define TASK_EXIT(t) do { (t).line = 0; return true; } while (0)
+
+#endif // TASK_H
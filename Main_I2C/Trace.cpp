@@ -0,0 +1,114 @@
+#include "Trace.h"
+#include "Classes.h"
+#include <EEPROM.h>
+#include "EEPROM_ADDRESSES.h"
+
+Trace trace;
+
+Trace::Trace() : m_buffer(), m_head(0), m_unflushed(0), m_lastTime(0), m_lastFlush(0), m_eepromHead(0), m_lap(0), m_clock(nullptr)
+{}
+
+// Entries written in the current pass over the EEPROM ring have the opposite lap bit to the ones from the previous pass,
+// so the write position is the first entry whose lap bit differs from the first one.
+void Trace::begin(Clock* cl)
+{
+	m_clock = cl;
+
+	byte first = EEPROM.read(TRACE_EEPROM_ADDR) & TRACE_LAP_BIT;
+	m_eepromHead = 0;
+	m_lap = first ^ TRACE_LAP_BIT;
+	for (byte i = 1; i < TRACE_EEPROM_ENTRIES; i++)
+	{
+		if ((EEPROM.read(TRACE_EEPROM_ADDR + i*sizeof(TraceEntry)) & TRACE_LAP_BIT) != first)
+		{
+			m_eepromHead = i;
+			m_lap = first;
+			break;
+		}
+	}
+
+	record(TRACE_BOOT);
+	if (m_clock)
+		record(TRACE_RTC_DATE, (m_clock->getMonth() << 8) | m_clock->getDay());
+	recordTime();
+}
+
+void Trace::record(byte type, unsigned int arg)
+{
+	unsigned long now = millis();
+	unsigned long elapsed = now - m_lastTime;
+
+	TraceEntry& entry = m_buffer[m_head];
+	entry.type = type;
+	entry.arg = arg;
+	if (elapsed < TRACE_DT_SECONDS)
+	{
+		entry.dt = elapsed;
+		m_lastTime = now;
+	}
+	else
+	{
+		unsigned long seconds = elapsed / 1000;
+		entry.dt = TRACE_DT_SECONDS | (seconds < TRACE_DT_SECONDS ? seconds : TRACE_DT_SECONDS - 1);
+		m_lastTime = now - elapsed % 1000; // keep the remainder for the next entry
+	}
+
+	m_head = (m_head + 1) % TRACE_BUFFER_SIZE;
+	if (m_unflushed < TRACE_BUFFER_SIZE)
+		m_unflushed++;
+}
+
+void Trace::recordTime()
+{
+	if (m_clock)
+		record(TRACE_RTC_TIME, m_clock->getHour()*60 + m_clock->getMin());
+}
+
+void Trace::flush()
+{
+	for (byte n = m_unflushed; n > 0; n--)
+	{
+		TraceEntry entry = m_buffer[(m_head + TRACE_BUFFER_SIZE - n) % TRACE_BUFFER_SIZE];
+		entry.type |= m_lap;
+		EEPROM.put(TRACE_EEPROM_ADDR + m_eepromHead*sizeof(TraceEntry), entry);
+
+		m_eepromHead++;
+		if (m_eepromHead == TRACE_EEPROM_ENTRIES)
+		{
+			m_eepromHead = 0;
+			m_lap ^= TRACE_LAP_BIT;
+		}
+	}
+	m_unflushed = 0;
+	m_lastFlush = millis();
+}
+
+// Oldest first: the EEPROM ring starting at the write position, then whatever has not been flushed yet.
+// One entry per line, as the hex of its bytes in memory order (little-endian).
+void Trace::dump(Print* out) const
+{
+	out->println(F("TRACE"));
+	for (byte i = 0; i < TRACE_EEPROM_ENTRIES; i++)
+	{
+		TraceEntry entry;
+		EEPROM.get(TRACE_EEPROM_ADDR + ((m_eepromHead + i) % TRACE_EEPROM_ENTRIES)*sizeof(TraceEntry), entry);
+		if ((entry.type & TRACE_TYPE_MASK) == TRACE_TYPE_MASK) // blank
+			continue;
+		m_dumpEntry(out, entry);
+	}
+	for (byte n = m_unflushed; n > 0; n--)
+		m_dumpEntry(out, m_buffer[(m_head + TRACE_BUFFER_SIZE - n) % TRACE_BUFFER_SIZE]);
+	out->println(F("END"));
+}
+
+void Trace::m_dumpEntry(Print* out, const TraceEntry& entry) const
+{
+	const byte* bytes = reinterpret_cast<const byte*>(&entry);
+	for (byte i = 0; i < sizeof(TraceEntry); i++)
+	{
+		if (bytes[i] < 0x10)
+			out->print('0');
+		out->print(bytes[i], HEX);
+	}
+	out->println();
+}
@@ -0,0 +1,78 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <arduino.h>
+
+#define TRACE_BUFFER_SIZE 24			// entries kept in SRAM (5 bytes each)
+#define TRACE_FLUSH_INTERVAL 3600000	// (1 hour) How often new entries are copied to EEPROM, besides after every door move
+
+// Entry types. The top bit of the stored type is the EEPROM lap marker, so there is room for 127 types.
+#define TRACE_BOOT 1
+#define TRACE_ENQUEUE 2			// arg = event code
+#define TRACE_PROCESS 3			// arg = event code
+#define TRACE_DOOR_START 4		// arg = TRACE_DOOR_OPEN, TRACE_DOOR_CLOSE or TRACE_DOOR_CALIBRATE
+#define TRACE_DOOR_STOP 5		// arg = steps taken
+#define TRACE_RTC_TIME 6		// arg = hour*60 + minute
+#define TRACE_RTC_DATE 7		// arg = month*256 + day
+#define TRACE_DRIFT 8			// arg = steps taken by the opening that was flagged
+#define TRACE_LOW_MEMORY 9		// arg = stack headroom in bytes
+#define TRACE_BOOT_PHASE 10		// arg = TRACE_BOOT_STATE, TRACE_BOOT_DECISION, TRACE_BOOT_DISPLAY or TRACE_BOOT_READY
+#define TRACE_HOMING_COARSE 11	// arg = steps of the fast pass of a calibration
+#define TRACE_HOMING_FINE 12	// arg = steps of the slow pass, after backing off
+#define TRACE_HOMING_FAILED 13	// arg = HOMING_FAST, HOMING_BACKOFF or HOMING_SLOW, the pass that went wrong
+#define TRACE_TYPE_MASK 0x7F
+#define TRACE_LAP_BIT 0x80
+
+#define TRACE_DOOR_OPEN 1
+#define TRACE_DOOR_CLOSE 2
+#define TRACE_DOOR_CALIBRATE 3
+
+// Boot phases, in the order setup() goes through them
+#define TRACE_BOOT_STATE 1		// settings and door positions restored
+#define TRACE_BOOT_DECISION 2	// doors started towards where the clock says they should be
+#define TRACE_BOOT_DISPLAY 3	// LCD up
+#define TRACE_BOOT_READY 4		// listeners and tasks added
+
+// Time since the previous entry. Gaps too long for milliseconds are stored in seconds, with the top bit set.
+#define TRACE_DT_SECONDS 0x8000
+
+class Clock;
+class Print;
+
+struct TraceEntry
+{
+	byte type;
+	uint16_t dt;
+	uint16_t arg;
+} __attribute__((packed));
+
+// Binary record of what the firmware saw. Entries go into a ring in SRAM, and new ones are copied to a ring in
+// spare EEPROM every TRACE_FLUSH_INTERVAL and after each door move, so they survive a reset.
+// dump() prints both as hex. Use TraceDecoder.py to turn that into a timeline.
+class Trace
+{
+public:
+	Trace();
+	void begin(Clock* cl);						// Finds the write position in EEPROM and records the boot.
+	void record(byte type, unsigned int arg = 0);
+	void recordTime();							// Records the current RTC time.
+	void flush();
+	bool flushDue() const {return m_unflushed > 0 && (millis() - m_lastFlush >= TRACE_FLUSH_INTERVAL);}
+	void dump(Print* out) const;
+
+private:
+	TraceEntry m_buffer[TRACE_BUFFER_SIZE];
+	byte m_head;			// next entry to write in m_buffer
+	byte m_unflushed;		// entries in m_buffer that are not in EEPROM yet
+	unsigned long m_lastTime;
+	unsigned long m_lastFlush;
+	byte m_eepromHead;		// next entry to write in EEPROM
+	byte m_lap;				// lap marker for entries written in this pass over the EEPROM ring
+	Clock* m_clock;
+
+	void m_dumpEntry(Print* out, const TraceEntry& entry) const;
+};
+
+extern Trace trace;
+
+#endif // TRACE_H
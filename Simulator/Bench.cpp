@@ -0,0 +1,269 @@
+// Times the firmware's hot paths on the host, and compares them with a stored baseline.
+//   ./bench                                   prints name,ns_per_op,iterations,relative
+//   ./bench --save bench_baseline.csv         also stores the results
+//   ./bench --baseline bench_baseline.csv [--max-regression 25]
+//                                             adds the change against the baseline, and fails if anything got
+//                                             slower by more than the given percentage
+// relative is the time of a benchmark over the time of the reference one (a CRC over a fixed buffer, which no change
+// to the firmware's hot paths touches), both the fastest of their rounds. The baseline is compared on it, so a machine that
+// runs faster or slower as a whole, from one run to the next, does not show up as a change.
+// A comparison that fails is measured again, up to ATTEMPTS times in all, keeping the fastest times: a slow spell long
+// enough to last a whole measurement does not come back every time, a real regression does.
+// Times are for this PC, not for the ATmega328P: only compare runs made on the same machine.
+
+#include "Host.h"
+#include "Classes.h"
+#include "EventHandler.h"
+#include "Journal.h"
+#include "Settings.h"
+#include "StepperDriver.h"
+#include "SunSchedule.h"
+#include "Trace.h"
+#include <LiquidCrystal_I2C.h>
+#include <functional>
+#include <map>
+#include <time.h>
+#include <string>
+#include <vector>
+
+// Every benchmark is run once per round, the rounds one after the other, and the fastest run of each is kept (the
+// others were interrupted). A slow spell of the machine then costs a benchmark one round, not all of its runs.
+#define ROUNDS 41
+#define MIN_RUN_TIME 0.005	// seconds
+#define ATTEMPTS 3
+#define REFERENCE "reference"
+
+struct Bench
+{
+	std::string name;
+	std::function<void()> body;
+	unsigned long iterations;
+	double ns;			// per call, fastest round
+	double relative;	// over the reference
+};
+
+static std::vector<Bench> benches;
+static volatile int sink; // keeps results from being optimised away
+
+// CPU time of this thread, so that time spent running other processes is not counted
+static double cpuSeconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Seconds for the given number of calls
+static double run(Bench& bench, unsigned long iterations)
+{
+	double start = cpuSeconds();
+	for (unsigned long i = 0; i < iterations; i++)
+		bench.body();
+	return cpuSeconds() - start;
+}
+
+// Each benchmark keeps its own state, so that they can be run in any order
+static void add(const char* name, std::function<void()> body)
+{
+	Bench bench = {name, body, 0, 0, 0};
+	benches.push_back(bench);
+}
+
+// Keeps the fastest times of this call and the ones before
+static void measureAll()
+{
+	// Find an iteration count that takes long enough to time
+	for (size_t b = 0; b < benches.size(); b++)
+	{
+		if (benches[b].iterations)
+			continue;
+		unsigned long iterations = 1;
+		while (run(benches[b], iterations) < MIN_RUN_TIME)
+			iterations *= 2;
+		benches[b].iterations = iterations;
+	}
+
+	for (int r = 0; r < ROUNDS; r++)
+	{
+		for (size_t b = 0; b < benches.size(); b++)
+		{
+			double ns = run(benches[b], benches[b].iterations) * 1e9 / benches[b].iterations;
+			if (benches[b].ns == 0 || ns < benches[b].ns)
+				benches[b].ns = ns;
+		}
+	}
+
+	for (size_t b = 0; b < benches.size(); b++)
+		benches[b].relative = benches[b].ns / benches[0].ns;
+}
+
+static bool noEvent() {return false;}
+static void noCallback() {}
+
+// Relative times, by name
+static std::map<std::string, double> readBaseline(const char* path)
+{
+	std::map<std::string, double> baseline;
+	FILE* file = fopen(path, "r");
+	if (!file)
+	{
+		perror(path);
+		exit(2);
+	}
+
+	char line[128];
+	while (fgets(line, sizeof(line), file))
+	{
+		char name[64];
+		double ns, relative;
+		if (sscanf(line, "%63[^,],%lf,%lf", name, &ns, &relative) == 3)
+			baseline[name] = relative;
+	}
+	fclose(file);
+	return baseline;
+}
+
+int main(int argc, char** argv)
+{
+	const char* save_path = 0;
+	const char* baseline_path = 0;
+	double max_regression = -1;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--save")
+			save_path = argv[i + 1];
+		else if (arg == "--baseline")
+			baseline_path = argv[i + 1];
+		else if (arg == "--max-regression")
+			max_regression = atof(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	simSetDateTime(2024, 6, 21, 12, 0, 0);
+
+	// Reference
+	byte buffer[64];
+	for (byte i = 0; i < sizeof(buffer); i++)
+		buffer[i] = i * 37;
+	add(REFERENCE, [&]() {
+		byte crc = 0;
+		for (byte i = 0; i < sizeof(buffer); i++)
+			crc = crc8(crc, buffer[i]);
+		sink = crc;
+	});
+
+	// Event queue
+	EventQueue queue, full, empty;
+	for (byte i = 0; i < EVENT_QUEUE_SIZE; i++)
+		full.enqueue(i);
+	add("queue_fill_and_drain", [&]() {
+		for (byte i = 0; i < EVENT_QUEUE_SIZE; i++)
+			queue.enqueue(i);
+		while (!queue.empty())
+			sink = queue.pop();
+	});
+	add("queue_enqueue_full", [&]() {full.enqueue(1);});
+	add("queue_pop_empty", [&]() {sink = empty.pop();});
+
+	// Event handler
+	EventHandler handler;
+	for (byte i = 0; i < 12; i++)
+		handler.addListener(&noEvent, &noCallback);
+	add("listen_12_listeners", [&]() {handler.listen();});
+	add("enqueue_and_dispatch", [&]() {
+		handler.enqueueEvent(11);
+		handler.processEvent();
+	});
+
+	// Clock and sun schedule
+	Clock clock;
+	clock.setTimezone(1);
+	clock.setOpenDelay(15);
+	clock.setCloseDelay(-10);
+	add("clock_is_day", [&]() {sink = clock.isDay();});
+	add("clock_sunrise_listener", [&]() {sink = clock.sunriseListener();});
+	add("clock_open_time_str", [&]() {sink = clock.getOpenTimeStr().size();}); // day number, table lookups and m_addMinutes
+	int day = 1;
+	add("sun_schedule_lookup", [&]() {
+		sink = getSunriseHour(day) + getSunriseMinute(day) + getSunsetHour(day) + getSunsetMinute(day);
+		day = (day % 366) + 1;
+	});
+
+	// Display, drawing into the in-memory LCD: one per screen
+	StepperDriver motor(200, StepperPins<11, 10, 9, 8>());
+	LiquidCrystal_I2C lcd(0x27, 16, 2);
+	Settings settings;
+	Door door(0, 7, 200, &motor, &lcd, &settings);
+	DoorGroup doors(&door, 1);
+	Button right(4), left(5);
+	Display status(&lcd, &doors, &clock, &settings, &right, &left);
+	status.rightClick();
+	add("display_door_status", [&]() {status.refresh();});
+	Display date(&lcd, &doors, &clock, &settings, &right, &left);
+	date.rightClick();
+	date.rightClick();
+	add("display_temp_and_date", [&]() {date.refresh();});
+	Display counter(&lcd, &doors, &clock, &settings, &right, &left);
+	counter.rightClick();
+	counter.rightClick();
+	counter.rightClick();
+	counter.rightDoubleClick();
+	counter.rightLongClick();
+	add("display_delay_counter", [&]() {counter.refresh();});
+
+	std::map<std::string, double> baseline;
+	if (baseline_path)
+		baseline = readBaseline(baseline_path);
+
+	bool failed = true;
+	for (int attempt = 0; attempt < ATTEMPTS && failed; attempt++)
+	{
+		measureAll();
+		failed = false;
+		for (size_t i = 1; i < benches.size(); i++)
+		{
+			const Bench& b = benches[i];
+			if (max_regression >= 0 && baseline.count(b.name) && (b.relative / baseline[b.name] - 1) * 100 > max_regression)
+				failed = true;
+		}
+	}
+
+	printf(baseline_path ? "name,ns_per_op,iterations,relative,baseline_relative,change_pct\n" :
+		"name,ns_per_op,iterations,relative\n");
+	for (size_t i = 0; i < benches.size(); i++)
+	{
+		const Bench& b = benches[i];
+		printf("%s,%.1f,%lu,%.4g", b.name.c_str(), b.ns, b.iterations, b.relative);
+		if (baseline_path && i > 0 && baseline.count(b.name))
+		{
+			double change = (b.relative / baseline[b.name] - 1) * 100;
+			printf(",%.4g,%+.1f", baseline[b.name], change);
+			if (max_regression >= 0 && change > max_regression)
+				printf(",REGRESSION");
+		}
+		else if (baseline_path)
+			printf(",,");
+		printf("\n");
+	}
+
+	if (save_path)
+	{
+		FILE* file = fopen(save_path, "w");
+		if (!file)
+		{
+			perror(save_path);
+			return 2;
+		}
+		fprintf(file, "name,ns_per_op,relative\n");
+		for (size_t i = 0; i < benches.size(); i++)
+			fprintf(file, "%s,%.1f,%.4g\n", benches[i].name.c_str(), benches[i].ns, benches[i].relative);
+		fclose(file);
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+// Counts the I2C traffic of the real firmware against the fake RTC and LCD (see host/), per loop() and per callback,
+// and fails if an idle loop or a display refresh goes over its budget. Catches a getTime() added to a hot path.
+//   ./busbudget
+// Prints name,rtc_transactions,lcd_transactions,bytes,budget_transactions,budget_bytes, then checks that a timed out
+// RTC read is recovered from. Exits with 1 if over budget or if the recovery failed.
+
+#include "Host.h"
+#include "DoorModel.h"
+#include "I2CBus.h"
+#include "../Main_I2C/Main_I2C.ino"
+
+#define LOOP_INTERVAL 10	// simulated milliseconds between two loop() calls
+#define IDLE_TIME 300000	// (5 minutes) long enough to see minute changes and the display turning off
+
+struct Budget
+{
+	const char* name;
+	unsigned long transactions;	// both devices
+	unsigned long bytes;
+};
+
+// Lower these when the traffic goes down. Raising them needs a reason.
+static const Budget budgets[] =
+{
+	{"loop_idle", 8, 75},			// worst loop() whose callback, if any, left the bus alone
+	{"display_refresh", 170, 356},	// door status screen
+};
+
+static DoorModel doorModel(IN1, IN2, IN3, IN4, LIMIT_SWITCH, DEFAULT_STEPS_TO_CLOSE, STEPPER_DIRECTION);
+static bool overBudget = false;
+
+static int readPin(uint8_t pin)
+{
+	if (doorModel.switchPin(pin))
+		return doorModel.switchPressed() ? HIGH : LOW;
+	return LOW; // buttons are never pressed
+}
+
+static void writePin(uint8_t pin, uint8_t value)
+{
+	doorModel.pinWritten(pin);
+}
+
+static unsigned long bytes(const BusCount* counts)
+{
+	return counts[BUS_RTC].bytes + counts[BUS_LCD].bytes;
+}
+
+static void snapshot(BusCount* counts)
+{
+	counts[BUS_RTC] = simBusCount(BUS_RTC);
+	counts[BUS_LCD] = simBusCount(BUS_LCD);
+}
+
+static void report(const char* name, const BusCount* counts)
+{
+	unsigned long transactions = counts[BUS_RTC].transactions + counts[BUS_LCD].transactions;
+	printf("%s,%lu,%lu,%lu", name, counts[BUS_RTC].transactions, counts[BUS_LCD].transactions, bytes(counts));
+	for (size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++)
+	{
+		if (strcmp(budgets[i].name, name) != 0)
+			continue;
+		printf(",%lu,%lu", budgets[i].transactions, budgets[i].bytes);
+		if (transactions > budgets[i].transactions || bytes(counts) > budgets[i].bytes)
+		{
+			printf(",OVER BUDGET");
+			overBudget = true;
+		}
+		printf("\n");
+		return;
+	}
+	printf(",,\n");
+}
+
+// A callback that starts a door move leaves the rest of it to the tasks. Each run stands for a loop() a millisecond long.
+static void finishTasks()
+{
+	eventHdl.runTasks();
+	while (eventHdl.busy())
+	{
+		simAdvance(1);
+		eventHdl.runTasks();
+	}
+}
+
+template <class Body> static void measure(const char* name, Body body)
+{
+	simResetBusCounts();
+	body();
+	finishTasks();
+	BusCount counts[BUS_DEVICES];
+	snapshot(counts);
+	report(name, counts);
+}
+
+int main(int argc, char** argv)
+{
+	simOnPinRead(&readPin);
+	simOnPinWrite(&writePin);
+	simSetDateTime(2024, 6, 21, 3, 0, 0); // night, so the door stays closed while idling
+	setup();
+
+	printf("name,rtc_transactions,lcd_transactions,bytes,budget_transactions,budget_bytes\n");
+
+	// Idle: split every loop() into its listeners and its callback, so loops that only did their listening
+	// can be told apart from the ones that also redrew the screen
+	BusCount idle[BUS_DEVICES] = {}, worst[BUS_DEVICES] = {};
+	unsigned long end = millis() + IDLE_TIME;
+	while ((long)(millis() - end) < 0)
+	{
+		BusCount start[BUS_DEVICES], listened[BUS_DEVICES], done[BUS_DEVICES];
+		snapshot(start);
+		eventHdl.listen();
+		snapshot(listened);
+		eventHdl.processEvent();
+		finishTasks();
+		snapshot(done);
+
+		BusCount loop_counts[BUS_DEVICES];
+		for (byte d = 0; d < BUS_DEVICES; d++)
+		{
+			loop_counts[d].transactions = done[d].transactions - start[d].transactions;
+			loop_counts[d].bytes = done[d].bytes - start[d].bytes;
+		}
+		bool callback_used_bus = (bytes(done) != bytes(listened));
+		if (!callback_used_bus && bytes(loop_counts) > bytes(idle))
+			memcpy(idle, loop_counts, sizeof(idle));
+		if (bytes(loop_counts) > bytes(worst))
+			memcpy(worst, loop_counts, sizeof(worst));
+		simAdvance(LOOP_INTERVAL);
+	}
+	report("loop_idle", idle);
+	report("loop_worst", worst);
+
+	// Listeners, one at a time
+	measure("listener_day", []() {dayListener();});
+	measure("listener_night", []() {nightListener();});
+	measure("listener_click", []() {clickListener();});
+	measure("listener_display_timeout", []() {displayTimeoutListener();});
+	measure("listener_display_update", []() {displayUpdateListener();});
+	measure("listener_settings_commit", []() {settingsCommitListener();});
+	measure("listener_trace_flush", []() {traceFlushListener();});
+	measure("listener_low_memory", []() {lowMemoryListener();});
+
+	// Callbacks
+	measure("wake_up", []() {onRightClick();});
+	measure("display_refresh", []() {onDisplayUpdate();});
+	measure("next_screen", []() {onRightClick();});
+	measure("display_refresh_temp_and_date", []() {onDisplayUpdate();});
+	measure("display_timeout", []() {onDisplayTimeout();});
+	measure("door_open", []() {onDay();});
+	measure("door_close", []() {onNight();});
+
+	// A stuck bus: the read times out, the bus is recovered and the last good time is used
+	byte minute = myclock.getMin();
+	simBusFault(1);
+	bool recovered = (myclock.getMin() == minute && i2c.errors().timeouts == 1 && i2c.errors().recoveries == 1);
+	measure("after_recovery", []() {myclock.getMin();});
+	printf("bus_recovery,%s\n", recovered ? "ok" : "FAILED");
+
+	return (overBudget || !recovered) ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+// Sets the clock through the menus of the real firmware at the edges of each counter, and checks that the RTC is only
+// ever written a valid date and time: a step within a counter changes the clock, and a step past its end leaves the
+// clock where it was.
+//   ./clockmenu
+// Prints name,ok or name,FAILED for each step. Exits with 1 if any failed.
+
+#include "Host.h"
+#include "../Main_I2C/Main_I2C.ino"
+
+#define LOOP_INTERVAL 10	// simulated milliseconds between two loop() calls
+#define SETTLE_TIME 2000	// longer than the welcome message, which the menus wait for
+
+static bool failed = false;
+
+static void run()
+{
+	for (unsigned long t = 0; t < SETTLE_TIME; t += LOOP_INTERVAL)
+	{
+		loop();
+		simAdvance(LOOP_INTERVAL);
+	}
+}
+
+// Wakes the display up on the door status screen, then goes to the time or date counters: right double click, then
+// right clicks along the settings
+static void openCounter(byte right_clicks)
+{
+	display.turnOff();
+	display.rightClick();
+	display.rightDoubleClick();
+	for (byte i = 0; i < right_clicks; i++)
+		display.rightClick();
+	display.rightLongClick();
+}
+
+static void expect(const char* name, int year, byte month, byte day, byte hour, byte minute)
+{
+	bool ok = (myclock.getYear() == year && myclock.getMonth() == month && myclock.getDay() == day &&
+		myclock.getHour() == hour && myclock.getMin() == minute && simRtcBadWrites() == 0);
+	printf("%s,%s\n", name, ok ? "ok" : "FAILED");
+	failed = failed || !ok;
+}
+
+int main(int argc, char** argv)
+{
+	simSetDateTime(2023, 12, 31, 22, 0, 30);
+	setup();
+	run();
+
+	openCounter(3);			// TIME_MODIFY, then HOURS_COUNTER
+	display.rightClick();
+	expect("hour_up", 2023, 12, 31, 23, 0);
+	display.rightClick();
+	expect("hour_up_at_23", 2023, 12, 31, 23, 0);
+	display.rightLongClick();	// MINUTES_COUNTER
+	display.leftClick();
+	expect("minute_down_at_0", 2023, 12, 31, 23, 0);
+	display.rightClick();
+	expect("minute_up", 2023, 12, 31, 23, 1);
+
+	simSetDateTime(2023, 12, 31, 0, 59, 30);
+	display.rightClick();
+	expect("minute_up_at_59", 2023, 12, 31, 0, 59);
+	display.leftDoubleClick();	// HOURS_COUNTER
+	display.leftClick();
+	expect("hour_down_at_0", 2023, 12, 31, 0, 59);
+
+	openCounter(4);			// DATE_MODIFY, then YEAR_COUNTER
+	display.rightLongClick();	// MONTH_COUNTER
+	display.rightClick();
+	expect("month_up_at_12", 2023, 12, 31, 0, 59);
+	display.rightLongClick();	// DAY_COUNTER
+	display.rightClick();
+	expect("day_up_at_31", 2023, 12, 31, 0, 59);
+
+	simSetDateTime(2023, 2, 28, 12, 0, 30);
+	display.rightClick();
+	expect("day_up_at_28_february", 2023, 2, 28, 12, 0);
+	simSetDateTime(2024, 2, 28, 12, 0, 30);
+	display.rightClick();
+	expect("day_up_to_29_february", 2024, 2, 29, 12, 0);
+	simSetDateTime(2024, 1, 1, 12, 0, 30);
+	display.leftClick();
+	expect("day_down_at_1", 2024, 1, 1, 12, 0);
+	display.leftDoubleClick();	// MONTH_COUNTER
+	display.leftClick();
+	expect("month_down_at_1", 2024, 1, 1, 12, 0);
+	display.rightClick();
+	expect("month_up", 2024, 2, 1, 12, 0);
+
+	return failed ? 1 : 0;
+}
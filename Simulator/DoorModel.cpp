@@ -0,0 +1,48 @@
+#include "DoorModel.h"
+#include "Host.h"
+
+// Same table as StepperDriver.cpp: IN1 is the top bit
+static const byte halfStepPatterns[8] = {0b1010, 0b0010, 0b0110, 0b0100, 0b0101, 0b0001, 0b1001, 0b1000};
+
+DoorModel::DoorModel(byte in1, byte in2, byte in3, byte in4, byte limit_switch, int travel_steps, signed char open_direction) :
+m_switch(limit_switch), m_travel(travel_steps), m_direction(open_direction), m_phase(0), m_halfSteps(0)
+{
+	m_pins[0] = in1;
+	m_pins[1] = in2;
+	m_pins[2] = in3;
+	m_pins[3] = in4;
+}
+
+// The driver writes IN1 to IN4 in order, so the pattern is complete when IN4 is written
+bool DoorModel::pinWritten(byte pin)
+{
+	for (byte i = 0; i < 3; i++)
+	{
+		if (pin == m_pins[i])
+			return true;
+	}
+	if (pin != m_pins[3])
+		return false;
+
+	byte pattern = 0;
+	for (byte i = 0; i < 4; i++)
+		pattern = (pattern << 1) | (simPinState(m_pins[i]) ? 1 : 0);
+
+	for (byte phase = 0; phase < 8; phase++)
+	{
+		if (halfStepPatterns[phase] != pattern)
+			continue;
+
+		int delta = (phase - m_phase + 8) % 8;
+		if (delta > 4)
+			delta -= 8;
+		m_phase = phase;
+
+		// The door stops against the frame when closed
+		m_halfSteps += delta * m_direction;
+		if (m_halfSteps < 0)
+			m_halfSteps = 0;
+		break;
+	}
+	return true; // all coils off (released) leaves the door where it is
+}
@@ -0,0 +1,26 @@
+#ifndef DOORMODEL_H
+#define DOORMODEL_H
+
+#include <arduino.h>
+
+// A door on the end of a simulated stepper. Follows the coil pattern the firmware writes to IN1-IN4 (decoding it
+// back to a half-step position, like the motor would) and presses the limit switch once the door is fully open.
+class DoorModel
+{
+public:
+	DoorModel(byte in1, byte in2, byte in3, byte in4, byte limit_switch, int travel_steps, signed char open_direction);
+	bool pinWritten(byte pin);	// Call for every digitalWrite(). Returns true if the pin belongs to this door.
+	bool switchPin(byte pin) const {return pin == m_switch;}
+	bool switchPressed() const {return m_halfSteps >= 2*m_travel;}
+	int position() const {return m_halfSteps / 2;}	// in full steps from closed
+
+private:
+	byte m_pins[4];
+	byte m_switch;
+	int m_travel;
+	signed char m_direction;
+	byte m_phase;
+	int m_halfSteps;
+};
+
+#endif // DOORMODEL_H
@@ -0,0 +1,84 @@
+// Cuts the power to the real firmware while the RTC keeps time, and checks what the doors do when it comes back:
+// a sunrise or sunset that went by while the board was off is caught up with, and nothing else moves the doors,
+// even if they were left away from where the schedule would have them.
+//   ./powercycle
+// Prints name,ok or name,FAILED for each step. Exits with 1 if any failed.
+
+#include "Host.h"
+#include "DoorModel.h"
+#include "../Main_I2C/Main_I2C.ino"
+#include "Reboot.h"
+
+#define LOOP_INTERVAL 10	// simulated milliseconds between two loop() calls
+#define SETTLE_TIME 5000	// long enough for the listeners to see the time after a boot
+
+static DoorModel doorModel(IN1, IN2, IN3, IN4, LIMIT_SWITCH, DEFAULT_STEPS_TO_CLOSE, STEPPER_DIRECTION);
+static bool failed = false;
+
+static int readPin(uint8_t pin)
+{
+	if (doorModel.switchPin(pin))
+		return doorModel.switchPressed() ? HIGH : LOW;
+	return LOW; // buttons are never pressed
+}
+
+static void writePin(uint8_t pin, uint8_t value)
+{
+	doorModel.pinWritten(pin);
+}
+
+// loop() until any door move is over, then for SETTLE_TIME
+static void run()
+{
+	unsigned long end = millis() + SETTLE_TIME;
+	while ((long)(millis() - end) < 0 || eventHdl.busy())
+	{
+		loop();
+		simAdvance(eventHdl.busy() ? 1 : LOOP_INTERVAL);
+	}
+}
+
+// The power is off from now until the given time
+static void powerCycle(int year, byte month, byte day, byte hour, byte minute)
+{
+	simSetDateTime(year, month, day, hour, minute, 0);
+	reboot();
+	run();
+}
+
+static void expect(const char* name, bool open)
+{
+	bool ok = (doors.get(0)->isOpen() == open && doorModel.switchPressed() == open);
+	printf("%s,%s\n", name, ok ? "ok" : "FAILED");
+	failed = failed || !ok;
+}
+
+int main(int argc, char** argv)
+{
+	simOnPinRead(&readPin);
+	simOnPinWrite(&writePin);
+	simSetDateTime(2024, 6, 21, 2, 0, 0);
+	setup();
+	run();
+	expect("first_boot_at_night", false);
+
+	powerCycle(2024, 6, 21, 12, 0);
+	expect("off_across_sunrise", true);
+
+	// Closed by hand in the middle of the day: no sunrise or sunset has gone by since the one that was followed
+	doors.startClose();
+	run();
+	powerCycle(2024, 6, 21, 13, 0);
+	expect("off_between_sunrise_and_sunset", false);
+
+	powerCycle(2024, 6, 21, 14, 0);
+	expect("second_reboot_same_day", false);
+
+	powerCycle(2024, 6, 22, 1, 0);
+	expect("off_across_sunset", false);
+
+	powerCycle(2024, 6, 22, 12, 0);
+	expect("off_across_next_sunrise", true);
+
+	return failed ? 1 : 0;
+}
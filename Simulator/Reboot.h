@@ -0,0 +1,16 @@
+#ifndef REBOOT_H
+#define REBOOT_H
+
+// Include after Main_I2C.ino.
+#include <new>
+
+// A reset of the board: setup() runs again with what survives one (the EEPROM, the RTC, and the doors where they
+// are). On the host the firmware's objects keep their SRAM, so the event handler, which setup() only adds to, is
+// built again first. Everything else setup() reloads from the EEPROM.
+static void reboot()
+{
+	new (&eventHdl) EventHandler();
+	setup();
+}
+
+#endif // REBOOT_H
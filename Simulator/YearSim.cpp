@@ -0,0 +1,316 @@
+// Runs the real firmware (setup() and loop() from Main_I2C.ino) against a virtual RTC, fast-forwarded through
+// whole years, and checks every door move against the sunrise/sunset table.
+//   ./yearsim [--start 2024] [--years 4] [--timezone 1] [--open-delay 15] [--close-delay -10] [--tick 30] [--csv moves.csv]
+//             [--break 13:00-16:00] [--reboot 14:30] [--tolerance 1]
+// --break adds schedule rules that close the doors and open them again between those times every day. --reboot resets
+// the board at that time every day, and counts the boots that found a transition missed when none was.
+// Writes one CSV line per expected or actual move, then a summary with the simulation speed. Fails if a move is
+// missed, unexpected, or more than --tolerance minutes off (the RTC is read once a tick, so a tick that does not divide
+// a minute can make a move a minute late).
+
+#include "Host.h"
+#include "DoorModel.h"
+#include "../Main_I2C/Main_I2C.ino"
+#include "Reboot.h"
+#include "SunSchedule.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+struct Move
+{
+	long long minute;	// minutes since 2000-01-01 (RTC time)
+	bool open;
+	bool matched;
+};
+
+static DoorModel doorModel(IN1, IN2, IN3, IN4, LIMIT_SWITCH, DEFAULT_STEPS_TO_CLOSE, STEPPER_DIRECTION);
+
+static int readPin(uint8_t pin)
+{
+	if (doorModel.switchPin(pin))
+		return doorModel.switchPressed() ? HIGH : LOW;
+	return LOW; // buttons are never pressed
+}
+
+static void writePin(uint8_t pin, uint8_t value)
+{
+	doorModel.pinWritten(pin);
+}
+
+// Row of the sun tables for a date. The tables include February 29th, so other years skip it.
+static int tableRow(int year, byte month, byte day)
+{
+	int row = daysFromCivil(year, month, day) - daysFromCivil(year, 1, 1) + 1;
+	if (!isLeapYear(year) && month > 2)
+		row++;
+	return row;
+}
+
+static int clampToDay(int minute)
+{
+	return std::min(std::max(minute, 0), 1439);
+}
+
+static bool earlier(const Move& a, const Move& b)
+{
+	return a.minute < b.minute;
+}
+
+// break_start and break_end are minutes of the day, -1 without a break. The doors only move when a transition
+// changes what they should be, and at the same minute the last rule wins, as in Schedule. A sunrise or sunset that
+// the time zone and delay push into another day happens at the first or last minute of its own, also as in Schedule.
+static std::vector<Move> expectedMoves(int start_year, int years, int timezone, int open_delay, int close_delay,
+	int break_start, int break_end)
+{
+	std::vector<Move> moves;
+	long first = daysFromCivil(start_year, 1, 1);
+	long last = daysFromCivil(start_year + years, 1, 1);
+	bool open = false;
+	for (long d = first; d < last; d++)
+	{
+		int year;
+		byte month, day;
+		civilFromDays(d, year, month, day);
+		int row = tableRow(year, month, day);
+
+		int rise = getSunriseHour(row) * 60 + getSunriseMinute(row);
+		int set = getSunsetHour(row) * 60 + getSunsetMinute(row);
+		std::vector<Move> transitions;
+		Move sunrise = {d * 1440 + clampToDay(rise + timezone * 60 + open_delay), true, false};
+		Move sunset = {d * 1440 + clampToDay(set + timezone * 60 + close_delay), false, false};
+		transitions.push_back(sunrise);
+		transitions.push_back(sunset);
+		if (break_start >= 0)
+		{
+			Move close = {d * 1440 + break_start, false, false};
+			Move reopen = {d * 1440 + break_end, true, false};
+			transitions.push_back(close);
+			transitions.push_back(reopen);
+		}
+		std::stable_sort(transitions.begin(), transitions.end(), earlier);
+
+		for (size_t i = 0; i < transitions.size(); i++)
+		{
+			bool last_at_minute = (i + 1 == transitions.size() || transitions[i + 1].minute != transitions[i].minute);
+			if (last_at_minute && transitions[i].open != open)
+			{
+				open = transitions[i].open;
+				moves.push_back(transitions[i]);
+			}
+		}
+	}
+	return moves;
+}
+
+// "HH:MM" to minutes of the day
+static int parseMinute(const char* text)
+{
+	int hour, minute;
+	if (sscanf(text, "%d:%d", &hour, &minute) != 2)
+		return -1;
+	return hour * 60 + minute;
+}
+
+static void printDate(FILE* out, long long minute)
+{
+	int year;
+	byte month, day;
+	civilFromDays((long)(minute / 1440), year, month, day);
+	fprintf(out, "%04d-%02d-%02d", year, month, day);
+}
+
+static void printMinute(FILE* out, long long minute)
+{
+	int year;
+	byte month, day;
+	civilFromDays((long)(minute / 1440), year, month, day);
+	fprintf(out, "%04d-%02d-%02d %02d:%02d", year, month, day, (int)(minute % 1440) / 60, (int)(minute % 60));
+}
+
+int main(int argc, char** argv)
+{
+	int start_year = 2024;
+	int years = 1;
+	int timezone = 0;
+	int open_delay = 0;
+	int close_delay = 0;
+	int tick = 30;
+	int tolerance = 1;
+	const char* csv_path = 0;
+	int break_start = -1, break_end = -1;
+	int reboot_minute = -1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		int value = atoi(argv[i + 1]);
+		if (arg == "--start")
+			start_year = value;
+		else if (arg == "--years")
+			years = value;
+		else if (arg == "--timezone")
+			timezone = value;
+		else if (arg == "--open-delay")
+			open_delay = value;
+		else if (arg == "--close-delay")
+			close_delay = value;
+		else if (arg == "--tick")
+			tick = value;
+		else if (arg == "--tolerance")
+			tolerance = value;
+		else if (arg == "--csv")
+			csv_path = argv[i + 1];
+		else if (arg == "--break")
+		{
+			const char* dash = strchr(argv[i + 1], '-');
+			break_start = parseMinute(argv[i + 1]);
+			break_end = dash ? parseMinute(dash + 1) : -1;
+			if (break_start < 0 || break_end < 0)
+			{
+				fprintf(stderr, "--break takes HH:MM-HH:MM\n");
+				return 2;
+			}
+		}
+		else if (arg == "--reboot")
+		{
+			reboot_minute = parseMinute(argv[i + 1]);
+			if (reboot_minute < 0)
+			{
+				fprintf(stderr, "--reboot takes HH:MM\n");
+				return 2;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : stdout;
+	if (!csv)
+	{
+		perror(csv_path);
+		return 2;
+	}
+
+	simOnPinRead(&readPin);
+	simOnPinWrite(&writePin);
+	simSetDateTime(start_year, 1, 1, 0, 0, 0);
+
+	// In the EEPROM, as if set from the menus before, so that setup() and every reboot load them
+	settings.setTimezone(timezone);
+	settings.setOpenDelay(open_delay);
+	settings.setCloseDelay(close_delay);
+	settings.commit();
+
+	std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
+	setup();
+	if (break_start >= 0)
+	{
+		myclock.addRule(RULE_TIME, break_start, false);
+		myclock.addRule(RULE_TIME, break_end, true);
+	}
+	myclock.sunriseListener(); // start the edge detection from the current time
+	myclock.sunsetListener();
+
+	std::vector<Move> actual;
+	long long end = daysFromCivil(start_year + years, 1, 1) * 86400LL;
+	long long next_reboot = daysFromCivil(start_year, 1, 1) * 86400LL + reboot_minute * 60LL;
+	unsigned long loops = 0;
+	int reboots = 0, false_catch_ups = 0;
+	while (simNow() < end)
+	{
+		long long now = simNow();
+		// The rules are still there afterwards: on the board, setup() would add them again
+		if (reboot_minute >= 0 && now >= next_reboot)
+		{
+			if (myclock.transitionMissed())
+				false_catch_ups++;
+			reboot();
+			reboots++;
+			next_reboot += 86400;
+		}
+		bool was_open = doors.get(0)->isOpen();
+		loop();
+		loops++;
+		while (eventHdl.busy()) // a door move or a message on the screen: loop() runs back to back until it is over
+		{
+			simAdvance(1);
+			loop();
+			loops++;
+		}
+		if (doors.get(0)->isOpen() != was_open)
+		{
+			Move move = {now / 60, !was_open, false};
+			actual.push_back(move);
+		}
+		simAdvance(tick * 1000UL);
+	}
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+	// Pair every expected move with the closest actual move of the same kind, up to 12 hours away
+	std::vector<Move> expected = expectedMoves(start_year, years, timezone, open_delay, close_delay, break_start, break_end);
+	int late = 0, too_late = 0, missed = 0, unexpected = 0;
+	long long worst = 0;
+	fprintf(csv, "date,move,expected,actual,difference_min\n");
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		Move& e = expected[i];
+		Move* best = 0;
+		for (size_t j = 0; j < actual.size(); j++)
+		{
+			Move& a = actual[j];
+			long long diff = a.minute - e.minute;
+			if (a.matched || a.open != e.open || diff > 720 || diff < -720)
+				continue;
+			if (!best || llabs(diff) < llabs(best->minute - e.minute))
+				best = &a;
+		}
+
+		printDate(csv, e.minute);
+		fprintf(csv, ",%s,", e.open ? "open" : "close");
+		printMinute(csv, e.minute);
+		fprintf(csv, ",");
+		if (best)
+		{
+			best->matched = true;
+			long long diff = best->minute - e.minute;
+			printMinute(csv, best->minute);
+			fprintf(csv, ",%lld\n", diff);
+			late += (diff != 0);
+			too_late += (llabs(diff) > tolerance);
+			if (llabs(diff) > llabs(worst))
+				worst = diff;
+		}
+		else
+		{
+			fprintf(csv, "missed,\n");
+			missed++;
+		}
+	}
+	for (size_t j = 0; j < actual.size(); j++)
+	{
+		if (actual[j].matched)
+			continue;
+		printDate(csv, actual[j].minute);
+		fprintf(csv, ",%s,unexpected,", actual[j].open ? "open" : "close");
+		printMinute(csv, actual[j].minute);
+		fprintf(csv, ",\n");
+		unexpected++;
+	}
+	if (csv != stdout)
+		fclose(csv);
+
+	double days = years * 365.2425;
+	fprintf(stderr, "%d year(s) from %d, timezone %+d, delays %+d/%+d min, %d s tick\n", years, start_year, timezone, open_delay, close_delay, tick);
+	fprintf(stderr, "%zu moves expected, %zu made: %d off time (worst %+lld min, %d over %d min), %d missed, %d unexpected\n",
+		expected.size(), actual.size(), late, worst, too_late, tolerance, missed, unexpected);
+	if (reboot_minute >= 0)
+		fprintf(stderr, "%d reboots, %d of them caught up with a transition that was not missed\n", reboots, false_catch_ups);
+	fprintf(stderr, "%.2f s wall clock: %.0f simulated days/s, %.0f loop()/s, %.0f door moves/s\n",
+		wall, days / wall, loops / wall, actual.size() / wall);
+
+	return (missed || unexpected || too_late || false_catch_ups) ? 1 : 0;
+}
@@ -0,0 +1,2 @@
+// The firmware includes <arduino.h>, which only resolves on a case-insensitive file system
+#include <Arduino.h>
@@ -0,0 +1,26 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <arduino.h>
+
+// 1 KB like the ATmega328P, blank (0xFF) at start. Counts writes, to compare wear between versions.
+class EEPROMClass
+{
+public:
+	EEPROMClass() : writes(0) {memset(m_data, 0xFF, sizeof(m_data));}
+	uint8_t read(int addr) {return m_data[addr];}
+	void write(int addr, uint8_t value) {m_data[addr] = value; writes++;}
+	void update(int addr, uint8_t value) {if (m_data[addr] != value) write(addr, value);}
+	template <class T> T& get(int addr, T& t) {memcpy(&t, m_data + addr, sizeof(T)); return t;}
+	template <class T> const T& put(int addr, const T& t) {for (size_t i = 0; i < sizeof(T); i++) update(addr + i, ((const uint8_t*)&t)[i]); return t;}
+	uint16_t length() {return sizeof(m_data);}
+
+	unsigned long writes;
+
+private:
+	uint8_t m_data[1024];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
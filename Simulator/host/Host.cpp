@@ -0,0 +1,295 @@
+#include "Host.h"
+#include <EEPROM.h>
+#include <Wire.h>
+#include "StackMonitor.h"
+
+// Each call to micros() lets this much time pass, so that busy waits (the stepper driver's) come to an end
+#define MICROS_PER_CALL 50
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+TwoWire Wire;
+
+char* __brkval = 0;
+char __malloc_heap_start[1];
+
+// Constant-initialised, so they are ready before the firmware's global constructors run
+static unsigned long long s_micros = 0;
+static long long s_rtcBase = 0;		// RTC time (seconds since 2000-01-01) when s_micros was 0
+static uint8_t s_pins[32];
+static PinReadHook s_readHook = 0;
+static PinWriteHook s_writeHook = 0;
+static BusCount s_bus[BUS_DEVICES];
+
+unsigned long millis()
+{
+	return (unsigned long)(s_micros / 1000);
+}
+
+unsigned long micros()
+{
+	s_micros += MICROS_PER_CALL;
+	return (unsigned long)s_micros;
+}
+
+void delay(unsigned long ms)
+{
+	s_micros += 1000ULL * ms;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	s_micros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{}
+
+int digitalRead(uint8_t pin)
+{
+	return s_readHook ? s_readHook(pin) : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin < sizeof(s_pins))
+		s_pins[pin] = value;
+	if (s_writeHook)
+		s_writeHook(pin, value);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	bytesWritten++;
+	if (echo)
+		putchar(c);
+	return 1;
+}
+
+void HardwareSerial::feed(const uint8_t* data, size_t size)
+{
+	if (m_head == m_tail)
+		m_head = m_tail = 0;
+	for (size_t i = 0; i < size && m_tail < sizeof(m_input); i++)
+		m_input[m_tail++] = data[i];
+}
+
+// No painted stack on a PC (see StackMonitor.h)
+unsigned int stackHeadroom()
+{
+	return RAMEND;
+}
+
+#if EXPERIMENTAL_STACK_PAINT
+unsigned int stackHighWater()
+{
+	return 0;
+}
+#endif
+
+/****************************************************************/
+/*						SIMULATION CONTROL						*/
+/****************************************************************/
+void simAdvance(unsigned long ms)
+{
+	s_micros += 1000ULL * ms;
+}
+
+void simSetDateTime(int year, byte month, byte day, byte hour, byte minute, byte second)
+{
+	long long now = daysFromCivil(year, month, day) * 86400LL + hour * 3600L + minute * 60L + second;
+	s_rtcBase = now - (long long)(s_micros / 1000000);
+}
+
+long long simNow()
+{
+	return s_rtcBase + (long long)(s_micros / 1000000);
+}
+
+unsigned long long simMicros()
+{
+	return s_micros;
+}
+
+// Howard Hinnant's days_from_civil, shifted to 2000-01-01
+long daysFromCivil(int year, byte month, byte day)
+{
+	year -= (month <= 2);
+	long era = (year >= 0 ? year : year - 399) / 400;
+	long yoe = year - era * 400;
+	long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 730425;
+}
+
+void civilFromDays(long days, int& year, byte& month, byte& day)
+{
+	days += 730425;
+	long era = (days >= 0 ? days : days - 146096) / 146097;
+	long doe = days - era * 146097;
+	long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long mp = (5 * doy + 2) / 153;
+	day = doy - (153 * mp + 2) / 5 + 1;
+	month = mp < 10 ? mp + 3 : mp - 9;
+	year = yoe + era * 400 + (month <= 2);
+}
+
+bool isLeapYear(int year)
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+void simOnPinRead(PinReadHook hook)
+{
+	s_readHook = hook;
+}
+
+void simOnPinWrite(PinWriteHook hook)
+{
+	s_writeHook = hook;
+}
+
+uint8_t simPinState(uint8_t pin)
+{
+	return (pin < sizeof(s_pins)) ? s_pins[pin] : LOW;
+}
+
+void simCountTraffic(byte device, byte transactions, unsigned int bytes)
+{
+	s_bus[device].transactions += transactions;
+	s_bus[device].bytes += bytes;
+}
+
+BusCount simBusCount(byte device)
+{
+	return s_bus[device];
+}
+
+void simResetBusCounts()
+{
+	memset(s_bus, 0, sizeof(s_bus));
+}
+
+/****************************************************************/
+/*						I2C BUS									*/
+/****************************************************************/
+#define RTC_ADDRESS 0x68
+#define RTC_REGISTERS 0x13
+#define RTC_TEMPERATURE 20 // degrees
+
+static uint8_t s_rtcPointer = 0;
+static byte s_faults = 0;
+static unsigned int s_rtcBadWrites = 0;
+
+static uint8_t toBcd(int value)
+{
+	return ((value / 10) << 4) | (value % 10);
+}
+
+static int fromBcd(uint8_t value)
+{
+	return (value >> 4) * 10 + (value & 0x0F);
+}
+
+// The DS3231's registers, made from the virtual clock
+static void rtcRead(uint8_t* regs)
+{
+	long long now = simNow();
+	long days = (long)(now / 86400);
+	long seconds = (long)(now % 86400);
+	int year;
+	byte month, day;
+	civilFromDays(days, year, month, day);
+
+	memset(regs, 0, RTC_REGISTERS);
+	regs[0] = toBcd(seconds % 60);
+	regs[1] = toBcd((seconds / 60) % 60);
+	regs[2] = toBcd(seconds / 3600);
+	regs[3] = (days + 5) % 7 + 1; // 2000-01-01 was a Saturday, and the DS3231 counts Monday as 1
+	regs[4] = toBcd(day);
+	regs[5] = toBcd(month) | (year >= 2100 ? 0x80 : 0);
+	regs[6] = toBcd(year % 100);
+	regs[0x11] = RTC_TEMPERATURE;
+}
+
+// A write sets the register pointer, then fills registers from there. Changes to the time move the virtual clock.
+// A write that leaves a register out of its range is counted and otherwise ignored (the DS3231 would keep it, and the
+// time it shows would be garbage from then on).
+static void rtcWrite(const uint8_t* data, uint8_t length)
+{
+	if (length == 0)
+		return;
+	s_rtcPointer = data[0];
+	if (length == 1)
+		return;
+
+	uint8_t regs[RTC_REGISTERS];
+	rtcRead(regs);
+	for (uint8_t i = 1; i < length && s_rtcPointer < RTC_REGISTERS; i++)
+		regs[s_rtcPointer++] = data[i];
+
+	int second = fromBcd(regs[0] & 0x7F), minute = fromBcd(regs[1]), hour = fromBcd(regs[2] & 0x3F);
+	int day = fromBcd(regs[4]), month = fromBcd(regs[5] & 0x1F);
+	int year = 2000 + fromBcd(regs[6]) + ((regs[5] & 0x80) ? 100 : 0);
+	if (second > 59 || minute > 59 || hour > 23 || month < 1 || month > 12 || day < 1 ||
+		daysFromCivil(year, month, day) >= daysFromCivil(year + month / 12, month % 12 + 1, 1))
+	{
+		s_rtcBadWrites++;
+		return;
+	}
+	simSetDateTime(year, month, day, hour, minute, second);
+}
+
+// A transaction runs from a START to a STOP, so a read after endTransmission(false) belongs to the same one.
+// The address byte is counted with the data.
+uint8_t TwoWire::endTransmission(bool stop)
+{
+	if (m_address != RTC_ADDRESS)
+		return 2; // address not acknowledged
+
+	simCountTraffic(BUS_RTC, m_restart ? 0 : 1, 1 + m_length);
+	m_restart = false;
+	if (s_faults)
+	{
+		s_faults--;
+		m_timedOut = true;
+		return 5;
+	}
+	m_restart = !stop;
+	rtcWrite(m_buffer, m_length);
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t count)
+{
+	m_length = 0;
+	m_position = 0;
+	if (address != RTC_ADDRESS)
+		return 0;
+
+	simCountTraffic(BUS_RTC, m_restart ? 0 : 1, 1 + count);
+	m_restart = false;
+	if (s_faults)
+	{
+		s_faults--;
+		m_timedOut = true;
+		return 0;
+	}
+
+	uint8_t regs[RTC_REGISTERS];
+	rtcRead(regs);
+	for (m_length = 0; m_length < count && m_length < sizeof(m_buffer); m_length++)
+		m_buffer[m_length] = (s_rtcPointer < RTC_REGISTERS) ? regs[s_rtcPointer++] : 0;
+	return m_length;
+}
+
+void simBusFault(byte transactions)
+{
+	s_faults = transactions;
+}
+
+unsigned int simRtcBadWrites()
+{
+	return s_rtcBadWrites;
+}
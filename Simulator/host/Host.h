@@ -0,0 +1,43 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <arduino.h>
+
+// Control over the simulated board, for the programs in Simulator/.
+// Time only moves when the firmware waits (delay(), or busy loops on micros()) or when simAdvance() is called.
+
+void simAdvance(unsigned long ms);
+void simSetDateTime(int year, byte month, byte day, byte hour, byte minute, byte second);
+long long simNow();				// RTC time, in seconds since 2000-01-01 00:00
+unsigned long long simMicros();	// time since start
+
+// Calendar helpers
+long daysFromCivil(int year, byte month, byte day);	// days since 2000-01-01
+void civilFromDays(long days, int& year, byte& month, byte& day);
+bool isLeapYear(int year);
+
+// Pins. Reads return what the hook says (LOW without one). Writes are passed to the hook after being stored.
+typedef int (*PinReadHook)(uint8_t pin);
+typedef void (*PinWriteHook)(uint8_t pin, uint8_t value);
+void simOnPinRead(PinReadHook hook);
+void simOnPinWrite(PinWriteHook hook);
+uint8_t simPinState(uint8_t pin);
+
+// I2C traffic of the fake RTC (on the fake Wire) and LCD (counted the way its library uses Wire), address bytes included
+#define BUS_RTC 0
+#define BUS_LCD 1
+#define BUS_DEVICES 2
+
+struct BusCount
+{
+	unsigned long transactions;
+	unsigned long bytes;
+};
+
+void simCountTraffic(byte device, byte transactions, unsigned int bytes);
+BusCount simBusCount(byte device);
+void simResetBusCounts();
+void simBusFault(byte transactions);	// the next RTC transactions time out, as if the bus were stuck
+unsigned int simRtcBadWrites();			// RTC writes with a register out of its range, refused by the fake DS3231
+
+#endif // HOST_H
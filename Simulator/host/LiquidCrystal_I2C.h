@@ -0,0 +1,39 @@
+#ifndef HOST_LIQUIDCRYSTAL_I2C_H
+#define HOST_LIQUIDCRYSTAL_I2C_H
+
+#include <arduino.h>
+#include "Host.h"
+
+// Every byte sent to the HD44780 goes out as two nibbles, each written three times to the PCF8574 backpack
+// (data, enable high, enable low), one 2-byte transaction each. init() is not counted.
+#define LCD_BYTE_TRANSACTIONS 6
+
+// Keeps the characters in memory, so what the firmware shows can be checked
+class LiquidCrystal_I2C : public Print
+{
+public:
+	LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows) : m_col(0), m_row(0), m_on(true) {m_clear();}
+	void init() {}
+	void backlight() {simCountTraffic(BUS_LCD, 1, 2);}
+	void noBacklight() {simCountTraffic(BUS_LCD, 1, 2);}
+	void display() {m_send(); m_on = true;}
+	void noDisplay() {m_send(); m_on = false;}
+	void clear() {m_send(); m_clear();}
+	void setCursor(uint8_t col, uint8_t row) {m_send(); m_col = col; m_row = row;}
+	size_t write(uint8_t c) {m_send(); if (m_col < 16 && m_row < 2) m_text[m_row][m_col] = c; m_col++; return 1;}
+	using Print::write;
+
+	std::string line(uint8_t row) const {return std::string(m_text[row], 16);}
+	bool isOn() const {return m_on;}
+
+private:
+	char m_text[2][16];
+	uint8_t m_col;
+	uint8_t m_row;
+	bool m_on;
+
+	void m_clear() {memset(m_text, ' ', sizeof(m_text)); m_col = 0; m_row = 0;}
+	void m_send() {simCountTraffic(BUS_LCD, LCD_BYTE_TRANSACTIONS, 2 * LCD_BYTE_TRANSACTIONS);}
+};
+
+#endif // HOST_LIQUIDCRYSTAL_I2C_H
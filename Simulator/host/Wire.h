@@ -0,0 +1,38 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <arduino.h>
+
+// I2C master for the simulated bus of Host.cpp, where a DS3231 at 0x68 runs on the virtual clock.
+// Nothing else answers (the LCD is faked a level up, in LiquidCrystal_I2C.h).
+class TwoWire
+{
+public:
+	TwoWire() : m_address(0), m_length(0), m_position(0), m_timedOut(false), m_restart(false) {}
+	void begin() {}
+	void end() {}
+	void setClock(uint32_t clock) {}
+	void setWireTimeout(uint32_t timeout = 25000, bool reset_with_timeout = false) {}
+	bool getWireTimeoutFlag() const {return m_timedOut;}
+	void clearWireTimeoutFlag() {m_timedOut = false;}
+
+	void beginTransmission(uint8_t address) {m_address = address; m_length = 0;}
+	size_t write(uint8_t data) {if (m_length < sizeof(m_buffer)) m_buffer[m_length++] = data; return 1;}
+	size_t write(const uint8_t* data, size_t count) {for (size_t i = 0; i < count; i++) write(data[i]); return count;}
+	uint8_t endTransmission(bool stop = true);
+	uint8_t requestFrom(uint8_t address, uint8_t count);
+	int available() const {return m_length - m_position;}
+	int read() {return (m_position < m_length) ? m_buffer[m_position++] : -1;}
+
+private:
+	uint8_t m_address;
+	uint8_t m_buffer[32];
+	uint8_t m_length;
+	uint8_t m_position;
+	bool m_timedOut;
+	bool m_restart;		// the last endTransmission() kept the bus, so the next START is a repeated one
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,122 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the firmware on a PC (see Host.cpp)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+// UNO pin numbers
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define SDA 18
+#define SCL 19
+
+// Flash is ordinary memory here
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(p))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+typedef char __FlashStringHelper;
+
+#undef abs
+#define abs(x) ((x) > 0 ? (x) : -(x))
+template <class T> T constrain(T x, T low, T high) {return x < low ? low : (x > high ? high : x);}
+
+// The ATmega328P's SRAM, for the memory reports
+#define RAMEND 0x8FF
+extern char* __brkval;
+extern char __malloc_heap_start[];
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class String : public std::string
+{
+public:
+	String() {}
+	String(const char* s) : std::string(s) {}
+	String(const std::string& s) : std::string(s) {}
+};
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	size_t write(const char* s) {size_t n = 0; while (*s) n += write((uint8_t)*s++); return n;}
+	size_t write(const uint8_t* buffer, size_t size) {for (size_t i = 0; i < size; i++) write(buffer[i]); return size;}
+
+	size_t print(const char* s) {return write(s);}
+	size_t print(const String& s) {return write(s.c_str());}
+	size_t print(char c) {return write((uint8_t)c);}
+	size_t print(long n, int base = DEC) {char b[24]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%ld", n); return write(b);}
+	size_t print(unsigned long n, int base = DEC) {char b[24]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%lu", n); return write(b);}
+	size_t print(int n, int base = DEC) {return print((long)n, base);}
+	size_t print(unsigned int n, int base = DEC) {return print((unsigned long)n, base);}
+	size_t print(unsigned char n, int base = DEC) {return print((unsigned long)n, base);}
+	size_t print(signed char n, int base = DEC) {return print((long)n, base);}
+	size_t print(double n, int digits = 2) {char b[32]; snprintf(b, sizeof(b), "%.*f", digits, n); return write(b);}
+
+	template <class T> size_t println(T value) {size_t n = print(value); return n + println();}
+	template <class T> size_t println(T value, int format) {size_t n = print(value, format); return n + println();}
+	size_t println() {return write("\r\n");}
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+};
+
+// Output goes to a counter (and stdout if echo is set). Input comes from feed().
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial() : echo(false), bytesWritten(0), m_head(0), m_tail(0) {}
+	void begin(unsigned long) {}
+	size_t write(uint8_t c);
+	int available() {return m_tail - m_head;}
+	int read() {return (m_head < m_tail) ? m_input[m_head++] : -1;}
+	void feed(const uint8_t* data, size_t size);
+	using Print::write;
+
+	bool echo;
+	unsigned long bytesWritten;
+
+private:
+	uint8_t m_input[256];
+	size_t m_head;
+	size_t m_tail;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
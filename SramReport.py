@@ -0,0 +1,81 @@
+import glob
+import os
+import subprocess
+import sys
+
+# Static SRAM (.data + .bss) used by each module of a build, so it is clear where the 2 KB of the UNO go.
+# Usage:
+#   arduino-cli compile --fqbn arduino:avr:uno --build-path build Main_I2C
+#   python SramReport.py build
+# Needs avr-nm and avr-size from the AVR toolchain (they come with the Arduino IDE) in the PATH.
+
+SRAM_SIZE = 2048
+
+# nm types of symbols that take SRAM: initialised data, zeroed data (lower case = static) and common symbols
+SRAM_TYPES = "bBdDC"
+
+
+def static_sram(path):
+	# Returns a list of (size, name) for the symbols of an object file or ELF that live in SRAM
+	output = subprocess.check_output(["avr-nm", "--size-sort", "-S", "-C", path]).decode("ascii", "replace")
+	symbols = []
+	for line in output.splitlines():
+		fields = line.split(None, 3)
+		if len(fields) == 4 and fields[2] in SRAM_TYPES:
+			symbols.append((int(fields[1], 16), fields[3]))
+	return symbols
+
+
+def section_sizes(elf):
+	output = subprocess.check_output(["avr-size", "-A", elf]).decode("ascii", "replace")
+	sizes = {}
+	for line in output.splitlines():
+		fields = line.split()
+		if len(fields) >= 2 and fields[0].startswith("."):
+			sizes[fields[0]] = int(fields[1])
+	return sizes
+
+
+def module_name(path, build):
+	name = os.path.relpath(path, build)
+	for suffix in (".cpp.o", ".c.o", ".S.o", ".ino.o"):
+		if name.endswith(suffix):
+			return name[:-len(suffix)]
+	return name
+
+
+def main():
+	if len(sys.argv) < 2:
+		print("Usage: python SramReport.py <build path>")
+		sys.exit(1)
+	build = sys.argv[1]
+
+	elfs = glob.glob(os.path.join(build, "*.elf"))
+	if not elfs:
+		print("No .elf in {0}".format(build))
+		sys.exit(1)
+
+	modules = []
+	for obj in glob.glob(os.path.join(build, "**", "*.o"), recursive=True):
+		symbols = static_sram(obj)
+		total = sum(size for size, name in symbols)
+		if total > 0:
+			modules.append((total, module_name(obj, build), symbols))
+	modules.sort(reverse=True)
+
+	print("Static SRAM by module")
+	for total, name, symbols in modules:
+		print("{0:6d}  {1}".format(total, name))
+		for size, symbol in sorted(symbols, reverse=True)[:5]:
+			print("        {0:6d}  {1}".format(size, symbol))
+
+	# Object files can keep symbols the linker drops, so the totals come from the ELF
+	sizes = section_sizes(elfs[0])
+	data = sizes.get(".data", 0)
+	bss = sizes.get(".bss", 0)
+	print("")
+	print(".data {0}, .bss {1}: {2} of {3} bytes static".format(data, bss, data + bss, SRAM_SIZE))
+	print("{0} bytes left for the heap and the stack".format(SRAM_SIZE - data - bss))
+
+
+main()
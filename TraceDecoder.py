@@ -0,0 +1,129 @@
+import struct
+import sys
+
+# Decodes the event trace printed by the firmware when it receives 'T' over Serial.
+# Usage:
+#   python TraceDecoder.py dump.txt         (a saved Serial log)
+#   python TraceDecoder.py /dev/ttyUSB0     (asks the board for a dump, needs pyserial)
+
+# Event codes are the order in which listeners are added in setup()
+event_names = ["day", "night", "click", "right click", "left click", "right double click", "left double click",
+				"right long click", "left long click", "limit switch", "display timeout", "display update",
+				"settings commit", "trace flush", "serial", "low memory"]
+
+door_moves = {1: "open", 2: "close", 3: "calibrate"}
+boot_phases = {1: "state restored", 2: "doors decided", 3: "display up", 4: "ready"}
+homing_passes = {0: "fast pass never reached the switch", 1: "switch still pressed after backing off",
+	2: "slow pass never reached the switch"}
+
+TYPE_MASK = 0x7F
+DT_SECONDS = 0x8000
+
+
+def read_dump(lines):
+	entries = []
+	inside = False
+	for line in lines:
+		line = line.strip()
+		if line == "TRACE":
+			inside = True
+			entries = []
+		elif line == "END":
+			inside = False
+		elif inside and len(line) == 10:
+			entries.append(struct.unpack("<BHH", bytes.fromhex(line)))
+	return entries
+
+
+def read_serial(port):
+	import serial
+	with serial.Serial(port, 9600, timeout=5) as ser:
+		ser.reset_input_buffer()
+		ser.write(b"T")
+		lines = []
+		while True:
+			line = ser.readline().decode("ascii", "replace")
+			if not line:
+				break
+			lines.append(line)
+			if line.strip() == "END":
+				break
+	return lines
+
+
+def event_name(code):
+	if code < len(event_names):
+		return event_names[code]
+	return "event {0}".format(code)
+
+
+def describe(kind, arg):
+	if kind == 1:
+		return "boot"
+	if kind == 2:
+		return "enqueue {0}".format(event_name(arg))
+	if kind == 3:
+		return "process {0}".format(event_name(arg))
+	if kind == 4:
+		# The high byte is the door number, counting from 0
+		move = door_moves.get(arg & 0xFF, arg & 0xFF)
+		return "door {0} {1} start".format((arg >> 8) + 1, move)
+	if kind == 5:
+		return "door stop after {0} steps".format(arg)
+	if kind == 6:
+		return "RTC time {0:02d}:{1:02d}".format(arg // 60, arg % 60)
+	if kind == 7:
+		return "RTC date {0:02d}/{1:02d}".format(arg & 0xFF, arg >> 8)
+	if kind == 8:
+		return "door drift, opened in {0} steps".format(arg)
+	if kind == 9:
+		return "low memory, {0} bytes of stack headroom".format(arg)
+	if kind == 10:
+		return "boot: {0}".format(boot_phases.get(arg, arg))
+	if kind == 11:
+		return "calibration fast pass, {0} steps".format(arg)
+	if kind == 12:
+		return "calibration slow pass, {0} steps".format(arg)
+	if kind == 13:
+		return "calibration failed: {0}".format(homing_passes.get(arg, arg))
+	return "unknown type {0} ({1})".format(kind, arg)
+
+
+def main():
+	if len(sys.argv) < 2:
+		lines = sys.stdin.readlines()
+	elif sys.argv[1].startswith("/dev/") or sys.argv[1].upper().startswith("COM"):
+		lines = read_serial(sys.argv[1])
+	else:
+		with open(sys.argv[1]) as file:
+			lines = file.readlines()
+
+	# Times are milliseconds since the last boot. RTC entries give the wall clock from then on.
+	uptime = 0
+	wall = None
+	for kind, dt, arg in read_dump(lines):
+		kind &= TYPE_MASK
+		if dt & DT_SECONDS:
+			dt = (dt & ~DT_SECONDS) * 1000
+		if kind == 1:
+			uptime = dt
+			wall = None
+			print("-" * 40)
+		else:
+			uptime += dt
+			if wall is not None:
+				wall += dt
+
+		if kind == 6:
+			wall = arg * 60000
+
+		if wall is None:
+			clock = "--:--:--"
+		else:
+			seconds = (wall // 1000) % 86400
+			clock = "{0:02d}:{1:02d}:{2:02d}".format(seconds // 3600, (seconds // 60) % 60, seconds % 60)
+
+		print("{0:>12.3f} s  {1}  {2}".format(uptime / 1000.0, clock, describe(kind, arg)))
+
+
+main()